@@ -0,0 +1,173 @@
+#ifndef OTHELLO_ANALYZE_H
+#define OTHELLO_ANALYZE_H
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core.h"
+#include "io.h"
+#include "pool.h"
+#include "search.h"
+
+namespace othello {
+
+// Searchers handed out to the tasks of a pool, one per running task.
+class searcher_pool {
+    std::vector<std::unique_ptr<search::searcher>> free;
+    std::mutex mutex;
+    search::settings config;
+
+public:
+    explicit searcher_pool(const search::settings &s)
+        : config(s)
+    {}
+
+    std::unique_ptr<search::searcher> acquire()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (free.empty())
+            return std::make_unique<search::searcher>(config);
+        auto s = std::move(free.back());
+        free.pop_back();
+        return s;
+    }
+
+    void release(std::unique_ptr<search::searcher> s)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        free.push_back(std::move(s));
+    }
+};
+
+// One line of analysis of a position:
+//   bestmove <pos> score <score> depth <depth> nodes <nodes> time_us <us>
+std::string analyze_position(const game &g, searcher_pool &searchers)
+{
+    if (g.is_game_over())
+        return "gameover winner " + io::to_string(g.winner());
+
+    auto searcher = searchers.acquire();
+    auto start = std::chrono::steady_clock::now();
+    search::result r = searcher->search(g);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    searchers.release(std::move(searcher));
+
+    return "bestmove " + io::to_string(pos::from_bitpos(r.best_move()))
+        + " score " + std::to_string(r.score)
+        + " depth " + std::to_string(r.depth)
+        + " nodes " + std::to_string(r.stats.nodes)
+        + " time_us " + std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+// Analyzes every snapshot line of in on all the pool threads and writes
+// one result line per input line to out, in input order, as soon as the
+// results at the head of the input are ready. At most window positions
+// are in flight, whatever the size of the input.
+void analyze(std::istream &in, std::ostream &out, const search::settings &s,
+    thread_pool &pool, unsigned window = 0)
+{
+    if (window == 0)
+        window = 4 * pool.size();
+
+    search::settings config = s;
+    if (!config.transpositions)
+        config.transpositions = std::make_shared<search::transposition_table>();
+    searcher_pool searchers(config);
+
+    std::deque<std::future<std::string>> pending;
+    auto ready = [](std::future<std::string> &f) {
+        return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    };
+    auto write_ready = [&](unsigned max_pending) {
+        bool written = false;
+        while (!pending.empty() && (pending.size() > max_pending || ready(pending.front()))) {
+            out << pending.front().get() << '\n';
+            pending.pop_front();
+            written = true;
+        }
+        if (written)
+            out.flush();
+    };
+
+    std::string line;
+    while (std::getline(in, line)) {
+        game g;
+        if (!io::parse_game(line, g)) {
+            std::promise<std::string> invalid;
+            invalid.set_value("error invalid position");
+            pending.push_back(invalid.get_future());
+        } else {
+            pending.push_back(pool.submit([g, &searchers]() {
+                return analyze_position(g, searchers);
+            }));
+        }
+        write_ready(window - 1);
+    }
+    write_ready(0);
+}
+
+// Review of one played move against the best move found by the search.
+// Scores are the usual white positive ones, drop is what the player lost
+// by the played move, from its own point of view.
+struct move_review {
+    piece_color player;
+    bitpos played;
+    bitpos best;
+    int played_score;
+    int best_score;
+    long long drop;
+};
+
+// Replays moves and searches every position before a move on all the pool
+// threads, one position per task, the best move and the played one with
+// the same depth. All the searches share a transposition table. Returns
+// false, with the reviews of the legal prefix, if a move is illegal.
+bool review_game(const std::vector<bitpos> &moves, const search::settings &s,
+    thread_pool &pool, std::vector<move_review> &reviews)
+{
+    search::settings config = s;
+    if (!config.transpositions)
+        config.transpositions = std::make_shared<search::transposition_table>();
+    searcher_pool searchers(config);
+
+    std::vector<std::future<move_review>> pending;
+    game g;
+    bool legal = true;
+    for (bitpos played : moves) {
+        if (g.is_game_over() || !g.can_play(played, g.player())) {
+            legal = false;
+            break;
+        }
+        pending.push_back(pool.submit([g, played, &searchers]() {
+            auto searcher = searchers.acquire();
+            search::result best = searcher->search(g);
+            search::result chosen = best.best_move() == played
+                ? best
+                : searcher->search(g, positions{played});
+            searchers.release(std::move(searcher));
+
+            long long drop = (long long)best.score - chosen.score;
+            if (g.player() == black)
+                drop = -drop;
+            return move_review{g.player(), played, best.best_move(), chosen.score, best.score,
+                std::max(drop, 0ll)}; // the narrower search may score higher
+        }));
+        g.place_piece(played);
+    }
+
+    reviews.clear();
+    for (auto &f : pending)
+        reviews.push_back(f.get());
+    return legal;
+}
+
+}
+
+#endif // OTHELLO_ANALYZE_H
@@ -0,0 +1,430 @@
+#ifndef OTHELLO_ASYNC_H
+#define OTHELLO_ASYNC_H
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "core.h"
+#include "play.h"
+#include "pool.h"
+#include "search.h"
+
+namespace othello::async {
+
+typedef std::chrono::steady_clock clock;
+
+// Lazy coroutine producing a T, started when awaited. The awaiting
+// coroutine resumes on the thread which completes the task.
+template<typename T>
+class task {
+public:
+    struct promise_type {
+        std::optional<T> value;
+        std::exception_ptr error;
+        std::coroutine_handle<> continuation;
+
+        task get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct final_awaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+                auto next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+        final_awaiter final_suspend() noexcept { return {}; }
+
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    task(task &&o) noexcept
+        : coroutine(std::exchange(o.coroutine, nullptr))
+    {}
+
+    task &operator=(task &&o) noexcept
+    {
+        std::swap(coroutine, o.coroutine);
+        return *this;
+    }
+
+    ~task()
+    {
+        if (coroutine)
+            coroutine.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        coroutine.promise().continuation = awaiting;
+        return coroutine;
+    }
+
+    T await_resume()
+    {
+        if (coroutine.promise().error)
+            std::rethrow_exception(coroutine.promise().error);
+        return std::move(*coroutine.promise().value);
+    }
+
+private:
+    std::coroutine_handle<promise_type> coroutine;
+
+    explicit task(std::coroutine_handle<promise_type> h)
+        : coroutine(h)
+    {}
+};
+
+// Coroutine nobody awaits, freed when it returns.
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+// Thread pool resuming coroutines, with timers. A coroutine blocks the
+// pool thread it runs on until its next suspension only, so a few threads
+// host any number of games waiting for moves.
+class executor {
+    std::thread timer_thread;
+    std::mutex timer_mutex;
+    std::condition_variable timer_changed;
+    std::multimap<clock::time_point, std::function<void()>> timers;
+    bool quitting = false;
+
+    thread_pool pool; // destroyed first, while its tasks may still set timers
+
+    void run_timers()
+    {
+        std::unique_lock<std::mutex> lock(timer_mutex);
+        while (!quitting) {
+            if (timers.empty()) {
+                timer_changed.wait(lock);
+                continue;
+            }
+            auto first = timers.begin();
+            if (clock::now() < first->first) {
+                timer_changed.wait_until(lock, first->first);
+                continue;
+            }
+            post(std::move(first->second));
+            timers.erase(first);
+        }
+    }
+
+public:
+    explicit executor(unsigned threads = thread_pool::default_size())
+        : pool(threads)
+    {
+        timer_thread = std::thread(&executor::run_timers, this);
+    }
+
+    // Drops the pending timers, then runs the posted work.
+    ~executor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(timer_mutex);
+            quitting = true;
+        }
+        timer_changed.notify_all();
+        timer_thread.join();
+    }
+
+    unsigned size() const { return pool.size(); }
+
+    void post(std::function<void()> f)
+    {
+        pool.submit(std::move(f));
+    }
+
+    void post_at(clock::time_point t, std::function<void()> f)
+    {
+        {
+            std::lock_guard<std::mutex> lock(timer_mutex);
+            if (quitting)
+                return;
+            timers.emplace(t, std::move(f));
+        }
+        timer_changed.notify_all();
+    }
+
+    // co_await ex.schedule() carries on on a pool thread.
+    auto schedule()
+    {
+        struct awaiter {
+            executor &ex;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { ex.post([h] { h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this};
+    }
+
+    // co_await ex.sleep_until(t) carries on on a pool thread once t is past.
+    auto sleep_until(clock::time_point t)
+    {
+        struct awaiter {
+            executor &ex;
+            clock::time_point t;
+            bool await_ready() const noexcept { return clock::now() >= t; }
+            void await_suspend(std::coroutine_handle<> h) { ex.post_at(t, [h] { h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return awaiter{*this, t};
+    }
+};
+
+// Starts t on the executor. Do not wait for the result on a pool thread.
+template<typename T>
+std::future<T> spawn(executor &ex, task<T> t)
+{
+    auto result = std::make_shared<std::promise<T>>();
+    auto f = result->get_future();
+    [](executor &ex, task<T> t, std::shared_ptr<std::promise<T>> result) -> detached {
+        co_await ex.schedule();
+        try {
+            result->set_value(co_await t);
+        } catch (...) {
+            result->set_exception(std::current_exception());
+        }
+    }(ex, std::move(t), result);
+    return f;
+}
+
+// Given to a strategy with each position: it should answer by the
+// deadline and give up once stop is requested, the answer being ignored.
+struct move_context {
+    std::stop_token stop;
+    clock::time_point deadline = clock::time_point::max();
+};
+
+task<bitpos> run_blocking(othello::strategy s, game g, piece_color player, positions moves)
+{
+    co_return s(g, player, moves);
+}
+
+// Strategy answering through a task. Its arguments are copied into the
+// coroutine, which may outlive the game that asked for the move.
+// Synchronous strategies convert to it and then run on a pool thread,
+// ignoring the context.
+class strategy {
+    std::function<task<bitpos>(game, piece_color, positions, move_context)> f;
+
+public:
+    template<typename F>
+        requires (!std::is_same_v<std::remove_cvref_t<F>, strategy>
+            && std::is_invocable_r_v<task<bitpos>, F &, game, piece_color, positions, move_context>)
+    strategy(F f_)
+        : f(std::move(f_))
+    {}
+
+    template<typename F>
+        requires std::is_invocable_r_v<bitpos, F &, const game &, piece_color, positions>
+    strategy(F s)
+        : f([s = othello::strategy(std::move(s))](game g, piece_color player, positions moves, move_context) {
+            return run_blocking(s, g, player, moves);
+        })
+    {}
+
+    task<bitpos> operator()(const game &g, piece_color player, positions moves, move_context context) const
+    {
+        return f(g, player, moves, context);
+    }
+};
+
+struct raise {
+    std::atomic<bool> &flag;
+    void operator()() const { flag = true; }
+};
+
+task<bitpos> run_search(std::shared_ptr<search::searcher> searcher, game g, positions moves, move_context context)
+{
+    std::atomic<bool> stop{false};
+    std::stop_callback<raise> on_stop(context.stop, raise{stop});
+    co_return searcher->search(g, moves, {.deadline = context.deadline, .stop = &stop}).best_move();
+}
+
+// Iterative deepening search answering with its last complete iteration at
+// the deadline, and stopping at once when cancelled. One searcher per game.
+strategy search_strategy(std::shared_ptr<search::searcher> searcher)
+{
+    return [searcher](game g, piece_color, positions moves, move_context context) {
+        return run_search(searcher, g, moves, context);
+    };
+}
+
+enum move_status { moved, late, cancelled };
+
+struct move_outcome {
+    move_status status = moved;
+    bitpos move = 0;
+};
+
+// Awaits the answer of a strategy, the deadline or stop, whichever comes
+// first. On the two last, the strategy is asked to stop and its answer,
+// still to come, is dropped.
+class move_race {
+    struct state {
+        std::mutex mutex;
+        bool finished = false;
+        move_outcome outcome;
+        std::exception_ptr error;
+        std::coroutine_handle<> waiting;
+        std::stop_source strategy_stop;
+        std::optional<std::stop_callback<std::function<void()>>> on_stop;
+    };
+
+    executor &ex;
+    task<bitpos> answer;
+    clock::time_point deadline;
+    std::stop_token stop;
+    std::shared_ptr<state> race;
+
+    static void finish(executor &ex, const std::shared_ptr<state> &s, move_outcome o,
+        std::exception_ptr error = nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (s->finished)
+                return;
+            s->finished = true;
+            s->outcome = o;
+            s->error = error;
+        }
+        if (o.status != moved)
+            s->strategy_stop.request_stop();
+        std::coroutine_handle<> h = s->waiting;
+        ex.post([h] { h.resume(); });
+    }
+
+    static detached answer_of(executor &ex, task<bitpos> answer, std::shared_ptr<state> s)
+    {
+        co_await ex.schedule();
+        try {
+            bitpos p = co_await answer;
+            finish(ex, s, {moved, p});
+        } catch (...) {
+            finish(ex, s, {moved, 0}, std::current_exception());
+        }
+    }
+
+public:
+    // strategy_stop is the source of the stop token given to the strategy.
+    move_race(executor &ex_, task<bitpos> answer_, std::stop_source strategy_stop,
+        clock::time_point deadline_, std::stop_token stop_)
+        : ex(ex_), answer(std::move(answer_)), deadline(deadline_), stop(std::move(stop_)),
+          race(std::make_shared<state>())
+    {
+        race->strategy_stop = std::move(strategy_stop);
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+        // once the strategy starts, this may be resumed and gone: only
+        // locals are used from here on
+        std::shared_ptr<state> s = race;
+        executor &e = ex;
+        clock::time_point t = deadline;
+        std::stop_token cancel = stop;
+        s->waiting = h;
+        answer_of(e, std::move(answer), s);
+        if (t != clock::time_point::max())
+            e.post_at(t, [&e, s] { finish(e, s, {late, 0}); });
+        std::weak_ptr<state> weak = s;
+        s->on_stop.emplace(cancel, [&e, weak] {
+            if (auto s = weak.lock())
+                finish(e, s, {cancelled, 0});
+        });
+    }
+
+    move_outcome await_resume()
+    {
+        std::lock_guard<std::mutex> lock(race->mutex);
+        if (race->error)
+            std::rethrow_exception(race->error);
+        return race->outcome;
+    }
+};
+
+struct time_control {
+    std::chrono::milliseconds per_move{0}; // no deadline when 0
+    // beyond the deadline given to the strategy before it loses on time
+    std::chrono::milliseconds grace{20};
+};
+
+struct game_result {
+    game final;
+    piece_color winner = none;
+    // player which missed its deadline or answered no legal move, losing
+    piece_color forfeited = none;
+    bool cancelled = false;
+};
+
+// Plays a game from g on the executor, every move bounded by the time
+// control. A stop request ends the game at once, cancelling the strategy
+// thinking.
+task<game_result> play(executor &ex, game g, strategy black_strategy, strategy white_strategy,
+    time_control control = time_control(), std::stop_token stop = std::stop_token())
+{
+    game_result r;
+    while (!g.is_game_over()) {
+        if (stop.stop_requested()) {
+            r.cancelled = true;
+            break;
+        }
+        piece_color player = g.player();
+        positions moves = g.possible_place_positions();
+        move_context context;
+        clock::time_point limit = clock::time_point::max();
+        if (control.per_move.count() > 0) {
+            context.deadline = clock::now() + control.per_move;
+            limit = context.deadline + control.grace;
+        }
+        std::stop_source strategy_stop;
+        context.stop = strategy_stop.get_token();
+        const strategy &s = player == white ? white_strategy : black_strategy;
+
+        move_outcome o = co_await move_race(ex, s(g, player, moves, context), strategy_stop, limit, stop);
+        if (o.status == cancelled) {
+            r.cancelled = true;
+            break;
+        }
+        if (o.status == late || !is_bitpos_valid(o.move) || !(o.move & moves.bitmap)) {
+            r.forfeited = player;
+            r.winner = opposite(player);
+            break;
+        }
+        g.place_piece(o.move);
+    }
+    r.final = g;
+    if (!r.cancelled && r.forfeited == none)
+        r.winner = g.winner();
+    co_return r;
+}
+
+}
+
+#endif // OTHELLO_ASYNC_H
@@ -1,18 +1,130 @@
 #include "othello.h"
 #include "colors.h"
+#include "perf.h"
+#include "report.h"
 
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <thread>
+
+#include <cerrno>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace std;
 using namespace othello;
 
-void benchmark_strategies(unsigned repeat, const vector<strat::strategy_index> &strategies)
+#ifndef VERSION
+#define VERSION "unknown"
+#endif
+
+// Start positions of the tournaments, from game::init when empty.
+vector<opening> suite;
+string suite_file = "-";
+
+const vector<opening> *openings()
+{
+    return suite.empty() ? nullptr : &suite;
+}
+
+struct move_timer {
+    chrono::high_resolution_clock::duration elapsed = {};
+    unsigned moves = 0;
+    vector<float> latencies; // us
+    search::statistics stats;
+};
+
+strategy timed(strategy strat, move_timer &timer)
+{
+    return [strat, &timer](const game &g, piece_color player, positions possible_positions) {
+        search::collect collected;
+        auto start = chrono::high_resolution_clock::now();
+        bitpos p = strat(g, player, possible_positions);
+        auto elapsed = chrono::high_resolution_clock::now() - start;
+        timer.elapsed += elapsed;
+        timer.moves++;
+        timer.latencies.push_back(chrono::duration<float, micro>(elapsed).count());
+        timer.stats.merge(collected.get());
+        return p;
+    };
+}
+
+void print_statistics(const move_timer &timer, const string &description)
+{
+    const search::statistics &s = timer.stats;
+    double moves = max(1u, timer.moves);
+    double seconds = chrono::duration<double>(timer.elapsed).count();
+    cout << description << ":" << endl
+        << "\tnodes/move " << s.nodes / moves << ", leaves/move " << s.leaves / moves
+        << ", nodes/s " << (seconds > 0 ? s.nodes / seconds : 0) << endl
+        << "\tbranching factor " << s.branching_factor() << " over " << s.max_ply() << " plies" << endl
+        << "\tcutoffs/move " << s.cutoffs / moves
+        << ", first move cutoff rate " << s.first_move_cutoff_rate()
+        << ", probcut cuts/move " << s.probcut_cuts / moves << endl
+        << "\ttable probes/move " << s.table_probes / moves
+        << ", hit rate " << s.table_hit_rate()
+        << ", endgame hand-offs/move " << s.endgame / moves << endl;
+    for (int depth = 1; depth < search::statistics::max_plies; depth++) {
+        if (!s.iterations[depth])
+            continue;
+        auto us = chrono::duration_cast<chrono::microseconds>(s.iteration_time[depth]).count();
+        cout << "\titeration " << depth << ": " << us / s.iterations[depth] << " us" << endl;
+    }
+}
+
+// Output of the tournaments: the coloured matrix, or a report::run.
+enum output_format { text, json, csv };
+output_format format = text;
+
+report::run make_report(const vector<strat::strategy_index> &strategies, unsigned repeat,
+    const vector<vector<double>> &winmatrix, const vector<move_timer> &timers, double seconds)
+{
+    report::run r;
+    r.metadata = report::host_metadata(VERSION);
+    r.metadata.push_back({"seed", to_string(othello::random::seed())});
+    r.metadata.push_back({"repeat", to_string(repeat)});
+    r.metadata.push_back({"openings", to_string(suite.size())});
+    r.elapsed_s = seconds;
+
+    unsigned n = strategies.size();
+    r.games = repeat * n * (n - 1) / 2.0;
+    for (unsigned i = 0; i < n; i++) {
+        report::strategy_result s;
+        s.name = strategies[i].description;
+        s.games = repeat * (n - 1.0);
+        s.moves = timers[i].moves;
+        s.nodes = timers[i].stats.nodes;
+        double busy = chrono::duration<double>(timers[i].elapsed).count();
+        s.nodes_per_s = busy > 0 ? s.nodes / busy : 0;
+        s.move_latency = report::latency::of(timers[i].latencies);
+        for (unsigned j = 0; j < n; j++)
+            if (j != i)
+                s.score += winmatrix[i][j];
+        s.score /= max(1u, n - 1);
+        // binomial bound, draws only make it narrower
+        double margin = 1.96 * sqrt(s.score * (1 - s.score) / max(1.0, s.games));
+        s.score_low = max(0.0, s.score - margin);
+        s.score_high = min(1.0, s.score + margin);
+        r.nodes += s.nodes;
+        r.strategies.push_back(s);
+    }
+    r.games_per_s = seconds > 0 ? r.games / seconds : 0;
+    r.nodes_per_s = seconds > 0 ? r.nodes / seconds : 0;
+    return r;
+}
+
+// Win rates of the row strategies against the column ones, and their
+// accumulated scores.
+void print_matrix(const vector<vector<double>> &winmatrix, const vector<strat::strategy_index> &strategies)
 {
-    auto winmatrix = winrate_matrix(strategies, repeat);
     auto acc_scores = accumulate_score(winmatrix);
 
     // header
@@ -53,26 +165,833 @@ void benchmark_strategies(unsigned repeat, const vector<strat::strategy_index> &
         cout << '\t' << acc_scores[i] << "\t - " << strategies[i].description << endl;
 }
 
-void benchmark(unsigned repeat)
+// Plays the tournament between strategies, timing each of their moves.
+vector<move_timer> benchmark_strategies(unsigned repeat, const vector<strat::strategy_index> &strategies)
 {
+    vector<move_timer> timers(strategies.size());
+    vector<strat::strategy_index> timed_strategies;
+    for (unsigned i = 0; i < strategies.size(); i++)
+        timed_strategies.push_back({strategies[i].description, timed(strategies[i].strat, timers[i])});
 
-    vector<strat::strategy_index> strategies = {
+    auto start = chrono::steady_clock::now();
+    auto winmatrix = winrate_matrix(timed_strategies, repeat, openings());
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (format != text) {
+        auto r = make_report(strategies, repeat, winmatrix, timers, seconds);
+        if (format == json)
+            report::write_json(cout, r);
+        else
+            report::write_csv(cout, r);
+        return timers;
+    }
+    print_matrix(winmatrix, strategies);
+    cout << "elapsed time: " << seconds << " s" << endl;
+    return timers;
+}
+
+vector<strat::strategy_index> tournament_strategies()
+{
+    return {
         {"random", strat::random_strategy},
         {"border 1st", strat::random_strategy_with_borders_first},
         {"corner 1st", strat::random_strategy_with_corners_and_borders_first},
         {"max # pieces", strat::max_pieces},
         {"max liberties", strat::max_liberty},
+        {"max mobility", strat::max_mobility},
         {"minmax 2", strat::minmax2},
-        {"minmax 4", strat::minmax4}
+        {"minmax 4", strat::minmax4},
+        {"minmax 2 stable", strat::minmax2stable}
+    };
+}
+
+void benchmark(unsigned repeat)
+{
+    benchmark_strategies(repeat, tournament_strategies());
+}
+
+// Plays the first moves at random, otherwise deterministic strategies
+// would replay the very same game over and over. Not needed, and left
+// out, when the games start from an opening suite.
+strategy with_random_opening(strategy strat, int plies=8)
+{
+    if (openings())
+        return strat;
+    return [strat, plies](const game &g, piece_color player, positions possible_positions) {
+        if (g.count<any>() < 4 + plies)
+            return strat::random_strategy(g, player, possible_positions);
+        return strat(g, player, possible_positions);
+    };
+}
+
+// Selective Multi-ProbCut search against plain depth limited search.
+void benchmark_search(unsigned repeat)
+{
+    vector<strat::strategy_index> searches = {
+        {"alphabeta 4", strat::alphabeta4},
+        {"alphabeta 6", strat::alphabeta6},
+        {"probcut 6", strat::probcut6},
+        {"probcut 8", strat::probcut8},
+        {"probcut 8 with pv", strat::search_strategy(make_shared<search::searcher>(search::settings{
+            .depth = 8,
+            .probcut_threshold = 1.0,
+            .transpositions = make_shared<search::transposition_table>(),
+        }))}
+    };
+
+    vector<strat::strategy_index> strategies;
+    for (auto &s : searches)
+        strategies.push_back({s.description, with_random_opening(s.strat)});
+
+    auto timers = benchmark_strategies(repeat, strategies);
+    if (format != text)
+        return;
+
+    cout << "-----------------------------------------------\n";
+    cout << "average time per move:\n";
+    for (unsigned i = 0; i < searches.size(); i++) {
+        auto us = chrono::duration_cast<chrono::microseconds>(timers[i].elapsed).count();
+        cout << '\t' << (timers[i].moves ? us / timers[i].moves : 0) << " us\t - " << searches[i].description << endl;
+    }
+
+    cout << "-----------------------------------------------\n";
+    cout << "search statistics:\n";
+    for (unsigned i = 0; i < searches.size(); i++)
+        print_statistics(timers[i], searches[i].description);
+}
+
+// Each search against the previous one of the ladder, every pairing
+// stopped as soon as the SPRT settles it.
+void benchmark_sprt(const sprt_settings &settings)
+{
+    vector<strat::strategy_index> ladder = {
+        {"minmax 2", strat::minmax2},
+        {"alphabeta 4", strat::alphabeta4},
+        {"probcut 6", strat::probcut6},
+        {"alphabeta 6", strat::alphabeta6},
+    };
+
+    cout << "H0: elo <= " << settings.elo0 << ", H1: elo >= " << settings.elo1
+        << ", alpha " << settings.alpha << ", beta " << settings.beta
+        << ", at most " << settings.max_games << " games" << endl;
+    for (unsigned i = 1; i < ladder.size(); i++) {
+        auto start = chrono::steady_clock::now();
+        sprt_result r = sprt(with_random_opening(ladder[i].strat), with_random_opening(ladder[i - 1].strat),
+            settings, openings());
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        const char *decisions[] = {"inconclusive", "H0", "H1"};
+        cout << ladder[i].description << " vs " << ladder[i - 1].description << ": "
+            << decisions[r.decision] << " after " << r.games() << " games (+"
+            << r.wins << " =" << r.draws << " -" << r.losses << "), llr " << setprecision(3) << r.llr
+            << ", elo " << fixed << setprecision(1) << r.elo()
+            << " [" << r.elo_low() << ", " << r.elo_high() << "]"
+            << ", " << seconds << " s" << defaultfloat << endl;
+    }
+}
+
+// Positions of varied games, n for each probcut phase.
+vector<vector<game>> probcut_corpus(unsigned n)
+{
+    vector<vector<game>> corpus(search::probcut_phases);
+    auto full = [&]() {
+        for (auto &phase : corpus)
+            if (phase.size() < n)
+                return false;
+        return true;
+    };
+
+    while (!full()) {
+        game g;
+        while (!g.is_game_over()) {
+            auto &phase = corpus[search::probcut_phase(g.count<any>())];
+            if (phase.size() < n && othello::random::below(4) == 0)
+                phase.push_back(g);
+
+            auto possible_positions = g.possible_place_positions();
+            bool explore = g.count<any>() < 12 || othello::random::below(4) == 0;
+            g.place_piece(explore
+                ? strat::random_strategy(g, g.player(), possible_positions)
+                : strat::max_mobility(g, g.player(), possible_positions));
+        }
+    }
+    return corpus;
+}
+
+// Least squares fit of deep = a * shallow + b over the corpus, printed as
+// the initializer of a search::probcut_table. Scores are taken from the
+// point of view of the player to move, so that b is the tempo bonus.
+void fit_probcut(unsigned n, score::function scoref=score::mobility_frontier)
+{
+    auto corpus = probcut_corpus(n);
+    auto decided = [](int v) { return v == INT_MAX || v == INT_MIN; };
+
+    cout << fixed << setprecision(3) << "{{" << endl;
+    for (unsigned phase = 0; phase < corpus.size(); phase++) {
+        // scores of every position for every depth
+        vector<vector<double>> scores;
+        for (const game &g : corpus[phase]) {
+            vector<double> v(search::probcut_max_depth + 1);
+            bool valid = true;
+            for (int depth = 1; depth <= search::probcut_max_depth; depth++) {
+                int score = search::alphabeta(g, depth, INT_MIN, INT_MAX, scoref);
+                valid = valid && !decided(score); // decided games are not predictions
+                v[depth] = (g.player() == white) ? score : -score;
+            }
+            if (valid)
+                scores.push_back(v);
+        }
+
+        cout << "    {{ // phase " << phase << ", " << scores.size() << " positions" << endl;
+        for (int depth = search::probcut_min_depth; depth <= search::probcut_max_depth; depth++) {
+            cout << "        {{";
+            for (int check = 0; check < search::probcut_checks; check++) {
+                int shallow = search::probcut_shallow_depth(depth, check);
+                double m = scores.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+                for (auto &v : scores) {
+                    sx += v[shallow];
+                    sy += v[depth];
+                    sxx += v[shallow] * v[shallow];
+                    sxy += v[shallow] * v[depth];
+                }
+
+                double a = 0, b = 0, sigma = 0;
+                if (shallow && m > 2 && m * sxx - sx * sx > 0) {
+                    a = (m * sxy - sx * sy) / (m * sxx - sx * sx);
+                    b = (sy - a * sx) / m;
+                    for (auto &v : scores) {
+                        double e = v[depth] - (a * v[shallow] + b);
+                        sigma += e * e;
+                    }
+                    sigma = sqrt(sigma / (m - 2));
+                } else {
+                    shallow = 0;
+                }
+                if (check)
+                    cout << ", ";
+                cout << "{" << shallow << ", " << a << ", " << b << ", " << sigma << "}";
+            }
+            cout << "}}," << endl;
+        }
+        cout << "    }}," << endl;
+    }
+    cout << "}};" << endl;
+}
+
+struct phase_sample {
+    string name;
+    double operations;
+    chrono::nanoseconds elapsed;
+    hardware_counters::sample counters;
+};
+
+void print_phase(const phase_sample &p, const string &unit)
+{
+    using hw = hardware_counters;
+    auto per_op = [&](hw::event e) -> string {
+        if (!p.counters.has(e))
+            return "n/a";
+        ostringstream out;
+        out << fixed << setprecision(1) << p.counters[e] / p.operations;
+        return out.str();
+    };
+    ostringstream ipc;
+    if (p.counters.has(hw::cycles) && p.counters.has(hw::instructions) && p.counters[hw::cycles] > 0)
+        ipc << fixed << setprecision(2) << p.counters[hw::instructions] / p.counters[hw::cycles];
+    else
+        ipc << "n/a";
+
+    cout << left << setw(20) << p.name << right
+        << setw(10) << fixed << setprecision(1) << p.elapsed.count() / p.operations
+        << setw(10) << per_op(hw::cycles)
+        << setw(10) << per_op(hw::instructions)
+        << setw(6) << ipc.str()
+        << setw(10) << per_op(hw::branch_misses)
+        << setw(10) << per_op(hw::l1d_misses)
+        << setw(10) << per_op(hw::llc_misses)
+        << "  per " << unit << endl;
+}
+
+// Hardware counters of the building blocks of the search, each measured
+// alone over the same positions, then of the whole search. The search
+// cost per node not explained by its move generations, moves and
+// evaluations is its own overhead: ordering, table, recursion.
+void benchmark_perf(unsigned n)
+{
+    hardware_counters counters;
+    if (!counters.any())
+        cout << "hardware counters unavailable (" << counters.error() << "), timing only" << endl;
+    else if (!counters.error().empty())
+        cout << "some hardware counters unavailable (" << counters.error() << ")" << endl;
+
+    vector<game> positions;
+    for (auto &phase : probcut_corpus(n))
+        positions.insert(positions.end(), phase.begin(), phase.end());
+
+    volatile uint64 sink = 0;
+    const unsigned repeat = 200;
+    auto measure = [&](const string &name, double operations, auto f) {
+        auto start = chrono::steady_clock::now();
+        auto sample = counters.measure(f);
+        return phase_sample{name, operations, chrono::steady_clock::now() - start, sample};
+    };
+
+    // the moves of every position, listed beforehand so that flipping
+    // times no move generation
+    struct move {
+        board8x8 board;
+        bitpos p;
+        piece_color player;
+    };
+    vector<move> played;
+    for (const game &g : positions)
+        for (bitpos p : g.possible_place_positions())
+            played.push_back({board8x8(g.bitmap<white>(), g.bitmap<black>()), p, g.player()});
+    double moves = played.size();
+
+    phase_sample movegen = measure("move generation", double(positions.size()) * repeat, [&]() {
+        for (unsigned i = 0; i < repeat; i++)
+            for (const game &g : positions)
+                sink = sink + g.possible_place_positions().bitmap;
+    });
+    // as game::test_piece on a copy, without its pass test, which is a
+    // move generation again
+    phase_sample flipping = measure("flipping", moves * repeat, [&]() {
+        for (unsigned i = 0; i < repeat; i++) {
+            for (const move &m : played) {
+                board8x8 b = m.board;
+                b.set(b.flips(m.p, m.player) | m.p, m.player);
+                sink = sink + b.bitmap<white>();
+            }
+        }
+    });
+    phase_sample evaluation = measure("evaluation", double(positions.size()) * repeat, [&]() {
+        for (unsigned i = 0; i < repeat; i++)
+            for (const game &g : positions)
+                sink = sink + score::mobility_frontier(g);
+    });
+
+    search::searcher searcher(search::settings{
+        .depth = 6,
+        .probcut_threshold = 1.0,
+        .transpositions = make_shared<search::transposition_table>(),
+    });
+    search::collect collected;
+    phase_sample search = measure("search", 1, [&]() {
+        for (const game &g : positions)
+            if (!g.is_game_over())
+                searcher.search(g);
+    });
+    const search::statistics &stats = collected.get();
+    search.operations = max(1ull, stats.nodes);
+
+    cout << positions.size() << " positions, " << stats.nodes << " search nodes" << endl;
+    cout << left << setw(20) << "phase" << right << setw(10) << "ns" << setw(10) << "cycles"
+        << setw(10) << "instr" << setw(6) << "IPC" << setw(10) << "br miss"
+        << setw(10) << "L1d miss" << setw(10) << "LLC miss" << endl;
+    for (auto &p : {movegen, flipping, evaluation})
+        print_phase(p, "call");
+    print_phase(search, "node");
+
+    // calls of each phase per search node
+    double interior = double(stats.nodes - stats.leaves) / stats.nodes;
+    double evaluated = double(stats.leaves - stats.endgame) / stats.nodes;
+    double flips = 1.0; // every node but the roots was reached by a move
+
+    auto total = [&](const phase_sample &p, double per_node, hardware_counters::event e) {
+        return p.counters.has(e) ? p.counters[e] / p.operations * per_node : 0.0;
+    };
+    auto time_total = [&](const phase_sample &p, double per_node) {
+        return p.elapsed.count() / p.operations * per_node;
+    };
+    bool cycles = search.counters.has(hardware_counters::cycles);
+    double search_cost = cycles
+        ? search.counters[hardware_counters::cycles] / search.operations
+        : time_total(search, 1);
+    auto cost = [&](const phase_sample &p, double per_node) {
+        return cycles ? total(p, per_node, hardware_counters::cycles) : time_total(p, per_node);
+    };
+
+    double parts[] = {cost(movegen, interior), cost(flipping, flips), cost(evaluation, evaluated)};
+    double overhead = search_cost - parts[0] - parts[1] - parts[2];
+    const char *labels[] = {"move generation", "flipping", "evaluation"};
+
+    cout << "-----------------------------------------------\n";
+    cout << "estimated " << (cycles ? "cycles" : "ns") << " per search node:" << endl;
+    for (int i = 0; i < 3; i++)
+        cout << '\t' << left << setw(20) << labels[i] << right << setw(10) << setprecision(1) << parts[i]
+            << setw(8) << 100 * parts[i] / search_cost << " %" << endl;
+    cout << '\t' << left << setw(20) << "search overhead" << right << setw(10) << overhead
+        << setw(8) << 100 * overhead / search_cost << " %" << endl;
+}
+
+// Exact solves of random endgames, serial then on threads, which must
+// agree on every score. The positions come from the run seed.
+int benchmark_endgame(int empties, unsigned n, unsigned threads)
+{
+    vector<game> positions;
+    while (positions.size() < n) {
+        game g;
+        while (!g.is_game_over() && g.count<none>() > empties)
+            g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+        if (!g.is_game_over())
+            positions.push_back(g);
+    }
+
+    auto solve_all = [&](unsigned t, vector<int> &scores) {
+        search::solve_result total;
+        for (const game &g : positions) {
+            auto r = search::endgame_solver({.threads = t}).solve(g);
+            scores.push_back(r.score);
+            total.nodes += r.nodes;
+            total.seconds += r.seconds;
+        }
+        return total;
     };
+    vector<int> serial_scores, parallel_scores;
+    auto serial = solve_all(1, serial_scores);
+    auto parallel = solve_all(threads, parallel_scores);
+
+    cout << positions.size() << " positions of " << empties << " empty squares" << endl;
+    cout << fixed << setprecision(3);
+    for (auto [t, r] : {make_pair(1u, serial), make_pair(threads, parallel)})
+        cout << '\t' << t << " threads\t" << r.seconds << " s\t" << r.nodes << " nodes\t"
+            << setprecision(0) << r.nodes / max(r.seconds, 1e-9) << " nodes/s" << setprecision(3) << endl;
+    cout << "speedup " << setprecision(2) << serial.seconds / max(parallel.seconds, 1e-9) << endl;
+    if (serial_scores != parallel_scores) {
+        cerr << "parallel scores differ from the serial ones" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Throughput and latency of a game server under the synthetic load of
+// sessions random clients.
+int benchmark_serve(const load_settings &load, unsigned threads)
+{
+    auto st = serve_load({.threads = threads, .search = {.depth = load.depth}}, load);
+    cout << load.sessions << " sessions of " << load.games << " games, depth " << load.depth << ", "
+        << load.move_ms << " ms per move, " << threads << " threads" << endl;
+    cout << fixed << setprecision(0);
+    cout << '\t' << st.moves << " moves in " << setprecision(2) << st.seconds << " s, "
+        << setprecision(0) << st.moves / max(st.seconds, 1e-9) << " moves/s" << endl;
+    cout << "\tlatency mean " << st.latency.mean << " p50 " << st.latency.p50 << " p90 " << st.latency.p90
+        << " p99 " << st.latency.p99 << " max " << st.latency.max << " us" << endl;
+    cout << '\t' << st.missed << " moves past their deadline" << endl;
+    return 0;
+}
+
+// Search speed with a large table on each page mode, best of three runs
+// from a cleared table. The mode each table obtained is printed: the ones
+// the system does not provide fall back to smaller pages.
+void benchmark_tables(int size_log2, int depth, unsigned n)
+{
+    vector<game> positions;
+    for (auto &phase : probcut_corpus(n))
+        for (const game &g : phase)
+            if (!g.is_game_over())
+                positions.push_back(g);
 
-    benchmark_strategies(repeat, strategies);
+    vector<memory_options> modes = {{small_pages}, {transparent_huge_pages}, {huge_pages}};
+    if (large_memory::online_nodes().size() > 1)
+        modes.push_back({transparent_huge_pages, true});
+    for (auto &mode : modes) {
+        auto table = make_shared<search::transposition_table>(size_log2, mode);
+        search::searcher searcher({.depth = depth, .transpositions = table});
+        double best = 0;
+        for (int run = 0; run < 3; run++) {
+            table->clear();
+            search::collect collected;
+            auto start = chrono::steady_clock::now();
+            for (const game &g : positions)
+                searcher.search(g);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            best = max(best, collected.get().nodes / seconds);
+        }
+        cout << setw(12) << fixed << setprecision(0) << best << " nodes/s\twanted " << to_string(mode.pages)
+            << (mode.interleave ? " interleaved" : "") << ", got " << table->allocation().describe() << endl;
+    }
+}
+
+// Balanced openings plies deep, searched at depth, written to filename.
+int generate_suite(const string &filename, int plies, int depth, int max_score)
+{
+    thread_pool pool;
+    auto start = chrono::steady_clock::now();
+    unsigned candidates = enumerate_openings(plies).size();
+    auto balanced = generate_openings(plies, {.depth = depth, .probcut_threshold = 1.0}, max_score, pool);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream out(filename, ios::binary);
+    write_openings(out, balanced);
+    if (!out) {
+        cerr << "cannot write " << filename << endl;
+        return 1;
+    }
+    cout << balanced.size() << " of " << candidates << " openings " << plies << " plies deep"
+        << " within " << max_score << " of even at depth " << depth
+        << ", " << seconds << " s" << endl;
+    return 0;
+}
+
+// Flags the regressions of the run in current against the one in base,
+// both written with --format json.
+int compare_runs(const string &base_file, const string &current_file)
+{
+    report::run base, current;
+    ifstream base_in(base_file), current_in(current_file);
+    if (!report::read_json(base_in, base) || !report::read_json(current_in, current)) {
+        cerr << "cannot read the json runs " << base_file << " and " << current_file << endl;
+        return 2;
+    }
+
+    auto ratio = [](double b, double c) { return b > 0 ? (c / b - 1) * 100 : 0; };
+    cout << fixed << setprecision(1)
+        << "games/s " << base.games_per_s << " -> " << current.games_per_s
+        << " (" << showpos << ratio(base.games_per_s, current.games_per_s) << noshowpos << " %), "
+        << "nodes/s " << base.nodes_per_s << " -> " << current.nodes_per_s
+        << " (" << showpos << ratio(base.nodes_per_s, current.nodes_per_s) << noshowpos << " %)" << endl;
+    for (auto &c : current.strategies) {
+        for (auto &b : base.strategies) {
+            if (b.name != c.name)
+                continue;
+            cout << '\t' << left << setw(20) << c.name << right
+                << " latency " << setw(10) << b.move_latency.mean << " -> " << setw(10) << c.move_latency.mean << " us"
+                << ", p99 " << setw(10) << b.move_latency.p99 << " -> " << setw(10) << c.move_latency.p99 << " us"
+                << ", score " << setprecision(3) << b.score << " -> " << c.score << setprecision(1) << endl;
+        }
+    }
+
+    auto regressions = report::compare(base, current);
+    for (auto &r : regressions) {
+        cout << "REGRESSION " << r.strategy << " " << r.what << ": " << r.base << " -> " << r.current;
+        if (r.z)
+            cout << " (z " << r.z << ")";
+        cout << endl;
+    }
+    if (regressions.empty())
+        cout << "no significant regression" << endl;
+    return regressions.empty() ? 0 : 1;
+}
+
+// Jobs of a queue directory, run by ./benchmark worker processes:
+//   game I J K SWAPPED   game K of the pairing of strategies I and J, as in
+//                        winrate, J playing black when SWAPPED is 1
+//   solve SNAPSHOT       search of the position at the setup depth
+// Results are the job line followed by the winner, or the analysis line.
+int queue_jobs(const string &dir, int argc, const char *argv[])
+{
+    jobs::queue q(dir);
+    if (q.exists()) {
+        cerr << dir << " already holds a job set" << endl;
+        return 1;
+    }
+    string kind = argc >= 1 ? argv[0] : "";
+    vector<string> lines;
+    int depth = 8;
+    if (kind == "tournament") {
+        unsigned repeat = argc >= 2 ? strtoul(argv[1], 0, 10) : 100;
+        unsigned n = tournament_strategies().size();
+        for (unsigned i = 0; i < n; i++)
+            for (unsigned j = i + 1; j < n; j++)
+                for (unsigned swapped = 0; swapped < 2; swapped++)
+                    for (unsigned k = 0; k < repeat / 2; k++)
+                        lines.push_back("game " + to_string(i) + " " + to_string(j) + " "
+                            + to_string(k) + " " + to_string(swapped));
+    } else if (kind == "solve" && argc >= 2) {
+        ifstream in(argv[1]);
+        if (!in) {
+            cerr << "cannot read " << argv[1] << endl;
+            return 1;
+        }
+        for (string line; getline(in, line);)
+            lines.push_back("solve " + line);
+        if (argc >= 3)
+            depth = atoi(argv[2]);
+    } else {
+        cerr << "queue DIR tournament [REPEAT] or queue DIR solve FILE [DEPTH]" << endl;
+        return 1;
+    }
+
+    q.create({{"kind", kind}, {"seed", to_string(othello::random::seed())},
+        {"openings", suite_file}, {"depth", to_string(depth)}});
+    for (unsigned i = 0; i < lines.size(); i++)
+        q.add(jobs::queue::make_id(i), lines[i]);
+    cout << lines.size() << " " << kind << " jobs queued in " << dir << endl;
+    return 0;
+}
+
+string run_job(const string &job, const vector<strat::strategy_index> &strategies, searcher_pool &searchers)
+{
+    istringstream in(job);
+    string kind;
+    in >> kind;
+    if (kind == "game") {
+        unsigned i, j, k, swapped;
+        if (!(in >> i >> j >> k >> swapped) || i >= strategies.size() || j >= strategies.size())
+            return job + " error";
+        othello::random::stream stream((uint64_t(swapped) << 32) + k);
+        game g = start_position(openings(), k);
+        auto winner = swapped ? play(g, strategies[j].strat, strategies[i].strat)
+                              : play(g, strategies[i].strat, strategies[j].strat);
+        return job + " " + io::to_string(winner);
+    }
+    game g;
+    if (kind != "solve" || !io::parse_game(job.substr(min(job.size(), kind.size() + 1)), g))
+        return "error invalid position";
+    return analyze_position(g, searchers);
+}
+
+// Runs jobs of dir until none is pending.
+int run_worker(const string &dir)
+{
+    jobs::queue q(dir);
+    if (!q.exists()) {
+        cerr << "no job set in " << dir << endl;
+        return 1;
+    }
+    auto setup = q.setup();
+    othello::random::seed(strtoull(setup["seed"].c_str(), 0, 10));
+    if (setup["openings"] != "-") {
+        ifstream in(setup["openings"], ios::binary);
+        if (!read_openings(in, suite) || suite.empty()) {
+            cerr << "cannot read the opening suite " << setup["openings"] << endl;
+            return 1;
+        }
+    }
+    search::settings config;
+    config.depth = atoi(setup["depth"].c_str());
+    config.transpositions = make_shared<search::transposition_table>();
+    searcher_pool searchers(config);
+    auto strategies = tournament_strategies();
+
+    string id, job;
+    unsigned done = 0;
+    while (q.claim(id, job)) {
+        q.complete(id, run_job(job, strategies, searchers));
+        done++;
+    }
+    cout << jobs::queue::worker_name() << ": " << done << " jobs" << endl;
+    return 0;
+}
+
+// Prints the progress of dir and its results so far, the win rate matrix
+// of the games played or the analysis lines in input order. Claims older
+// than stale seconds, if any, are requeued first: their worker is taken
+// for dead. Returns 0 once every job is done.
+int collect(const string &dir, long stale = 0)
+{
+    jobs::queue q(dir);
+    if (!q.exists()) {
+        cerr << "no job set in " << dir << endl;
+        return 2;
+    }
+    if (stale > 0) {
+        unsigned requeued = q.requeue([stale](const string &, chrono::seconds age) { return age.count() >= stale; });
+        if (requeued)
+            cout << requeued << " stale jobs requeued" << endl;
+    }
+
+    auto results = q.results();
+    unsigned pending = q.count("pending"), claimed = q.count("claimed");
+    cout << results.size() << " of " << results.size() + pending + claimed << " jobs done, "
+        << claimed << " running" << endl;
+
+    if (q.setup()["kind"] == "tournament") {
+        auto strategies = tournament_strategies();
+        unsigned n = strategies.size();
+        vector<vector<double>> wins(n, vector<double>(n)), games(n, vector<double>(n));
+        for (auto &r : results) {
+            istringstream in(r.second);
+            string kind, winner;
+            unsigned i, j, k, swapped;
+            if (!(in >> kind >> i >> j >> k >> swapped >> winner) || i >= n || j >= n)
+                continue;
+            piece_color i_color = swapped ? white : black;
+            double points = winner == io::to_string(i_color) ? 1 : winner == "none" ? 0.5 : 0;
+            wins[i][j] += points;
+            wins[j][i] += 1 - points;
+            games[i][j]++;
+            games[j][i]++;
+        }
+        vector<vector<double>> winmatrix(n, vector<double>(n, 0.5));
+        for (unsigned i = 0; i < n; i++)
+            for (unsigned j = 0; j < n; j++)
+                if (games[i][j] > 0)
+                    winmatrix[i][j] = wins[i][j] / games[i][j];
+        print_matrix(winmatrix, strategies);
+    } else {
+        for (auto &r : results)
+            cout << r.second << endl;
+    }
+    return pending + claimed ? 1 : 0;
+}
+
+// Whether worker, named by jobs::queue::worker_name, is a process of this
+// host which is gone.
+bool dead_local_worker(const string &worker)
+{
+    string self = jobs::queue::worker_name();
+    auto host = [](const string &name) { return name.substr(0, name.rfind('.')); };
+    if (host(worker) != host(self))
+        return false;
+    pid_t pid = atoi(worker.substr(worker.rfind('.') + 1).c_str());
+    return pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+}
+
+// Runs the jobs of dir on n local worker processes, replacing those which
+// fail and requeuing their jobs, then collects the results. Claims left
+// by the workers of an earlier, crashed, run on this host are requeued
+// first, so that running it again resumes the job set.
+int coordinate(const string &dir, unsigned n)
+{
+    jobs::queue q(dir);
+    if (!q.exists()) {
+        cerr << "no job set in " << dir << endl;
+        return 2;
+    }
+    unsigned resumed = q.requeue([](const string &worker, chrono::seconds) { return dead_local_worker(worker); });
+    if (resumed)
+        cout << resumed << " jobs of dead workers requeued" << endl;
+
+    string self = jobs::queue::worker_name();
+    string host = self.substr(0, self.rfind('.'));
+    map<pid_t, string> workers;
+    auto spawn = [&]() {
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0)
+            _exit(run_worker(dir));
+        if (pid > 0)
+            workers[pid] = host + "." + to_string(pid);
+        return pid > 0;
+    };
+    for (unsigned i = 0; i < n; i++)
+        spawn();
+
+    unsigned failures = 0;
+    while (!workers.empty()) {
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0)
+            break;
+        string worker = workers[pid];
+        workers.erase(pid);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+            continue;
+        unsigned requeued = q.requeue([&](const string &w, chrono::seconds) { return w == worker; });
+        cerr << "worker " << worker << " failed, " << requeued << " jobs requeued" << endl;
+        // give up on jobs which bring down every worker
+        if (++failures <= 2 * n && q.count("pending"))
+            spawn();
+    }
+    return collect(dir);
 }
 
 int main(int argc, const char * argv[]) {
+    // --trace FILE first writes a Chrome trace of the run to FILE,
+    // --openings FILE starts the tournament games from the suite in FILE,
+    // --seed N seeds every random choice, 1 by default,
+    // --format text|json|csv prints the tournaments as a report::run
+    string trace_file;
+    while (argc >= 3 && argv[1][0] == '-') {
+        if (string(argv[1]) == "--seed") {
+            othello::random::seed(strtoull(argv[2], 0, 10));
+        } else if (string(argv[1]) == "--format") {
+            string f = argv[2];
+            if (f != "text" && f != "json" && f != "csv") {
+                cerr << "unknown format " << f << ", text, json or csv" << endl;
+                return 1;
+            }
+            format = f == "json" ? json : f == "csv" ? csv : text;
+        } else if (string(argv[1]) == "--trace") {
+            trace_file = argv[2];
+            trace::start();
+        } else if (string(argv[1]) == "--openings") {
+            ifstream in(argv[2], ios::binary);
+            if (!read_openings(in, suite) || suite.empty()) {
+                cerr << "cannot read an opening suite from " << argv[2] << endl;
+                return 1;
+            }
+            suite_file = argv[2];
+        } else {
+            cerr << "unknown option " << argv[1] << endl;
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    struct trace_dump {
+        string file;
+        ~trace_dump()
+        {
+            if (file.empty())
+                return;
+            ofstream out(file);
+            trace::dump(out);
+        }
+    } dump{trace_file};
+
+    if (argc >= 4 && string(argv[1]) == "compare")
+        return compare_runs(argv[2], argv[3]);
+    if (argc >= 3 && string(argv[1]) == "queue")
+        return queue_jobs(argv[2], argc - 3, argv + 3);
+    if (argc == 3 && string(argv[1]) == "worker")
+        return run_worker(argv[2]);
+    if (argc >= 3 && string(argv[1]) == "coordinate")
+        return coordinate(argv[2], argc >= 4 ? strtoul(argv[3], 0, 10) : thread::hardware_concurrency());
+    if (argc >= 3 && string(argv[1]) == "collect")
+        return collect(argv[2], argc >= 4 ? atol(argv[3]) : 0);
+    if (argc >= 2 && string(argv[1]) == "fit-probcut") {
+        fit_probcut((argc == 3) ? strtoul(argv[2], 0, 10) : 200);
+        return 0;
+    }
+    if (argc >= 3 && string(argv[1]) == "openings") {
+        return generate_suite(argv[2],
+            argc >= 4 ? atoi(argv[3]) : 6,
+            argc >= 5 ? atoi(argv[4]) : 6,
+            argc >= 6 ? atoi(argv[5]) : 8);
+    }
+    if (argc >= 2 && string(argv[1]) == "tables") {
+        benchmark_tables(argc >= 3 ? atoi(argv[2]) : 24,
+            argc >= 4 ? atoi(argv[3]) : 8,
+            argc >= 5 ? strtoul(argv[4], 0, 10) : 20);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "serve") {
+        load_settings load;
+        if (argc >= 3)
+            load.sessions = strtoul(argv[2], 0, 10);
+        if (argc >= 4)
+            load.depth = atoi(argv[3]);
+        if (argc >= 5)
+            load.move_ms = strtoul(argv[4], 0, 10);
+        return benchmark_serve(load, argc >= 6 ? strtoul(argv[5], 0, 10) : thread_pool::default_size());
+    }
+    if (argc >= 2 && string(argv[1]) == "endgame") {
+        return benchmark_endgame(argc >= 3 ? atoi(argv[2]) : 20,
+            argc >= 4 ? strtoul(argv[3], 0, 10) : 10,
+            argc >= 5 ? strtoul(argv[4], 0, 10) : thread::hardware_concurrency());
+    }
+    if (argc >= 2 && string(argv[1]) == "perf") {
+        benchmark_perf((argc == 3) ? strtoul(argv[2], 0, 10) : 100);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "sprt") {
+        sprt_settings settings;
+        if (argc >= 4) {
+            settings.elo0 = atof(argv[2]);
+            settings.elo1 = atof(argv[3]);
+        }
+        if (argc >= 5)
+            settings.max_games = strtoul(argv[4], 0, 10);
+        benchmark_sprt(settings);
+        return 0;
+    }
+    if (argc >= 2 && string(argv[1]) == "search") {
+        benchmark_search((argc == 3) ? strtoul(argv[2], 0, 10) : 100);
+        return 0;
+    }
+
     unsigned repeat = (argc == 2) ? strtoul(argv[1], 0, 10) : 1000;
-    auto start = chrono::high_resolution_clock::now();
     benchmark(repeat);
-    auto finish = chrono::high_resolution_clock::now();
-    cout << "elapsed time: " << (finish - start).count() << endl;
 }
\ No newline at end of file
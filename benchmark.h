@@ -3,22 +3,43 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <sstream>
 #include <vector>
 #include <iostream>
 
 #include "core.h"
+#include "openings.h"
+#include "rng.h"
+#include "server.h"
+#include "strategy.h"
+#include "trace.h"
 
 using namespace std;
 using namespace othello;
 
-double wincount(strategy strategy_black, strategy strategy_white, unsigned n)
+// Game i starts from the opening i of the suite, when there is one.
+game start_position(const std::vector<opening> *openings, unsigned i)
+{
+    if (!openings || openings->empty())
+        return game();
+    return start_position((*openings)[i % openings->size()]);
+}
+
+// Game i draws its random numbers from stream first_stream + i.
+double wincount(strategy strategy_black, strategy strategy_white, unsigned n,
+    const std::vector<opening> *openings=nullptr, uint64_t first_stream=0)
 {
     game game;
     double wins = 0;
 
     for (unsigned i = 0; i < n; i++) {
-        game.init();
+        random::stream stream(first_stream + i);
+        game = start_position(openings, i);
         switch (play(game, strategy_black, strategy_white)) {
         case black:
             wins += 1;
@@ -34,12 +55,13 @@ double wincount(strategy strategy_black, strategy strategy_white, unsigned n)
     return wins;
 }
 
-double winrate(strategy a, strategy b, unsigned n)
+// Both colours play each opening of the suite in turn.
+double winrate(strategy a, strategy b, unsigned n, const std::vector<opening> *openings=nullptr)
 {
     assert(n % 2 == 0);
 
-    double win_as_blacks = wincount(a, b, n / 2);
-    double win_as_whites = n / 2 - wincount(b, a, n / 2);
+    double win_as_blacks = wincount(a, b, n / 2, openings);
+    double win_as_whites = n / 2 - wincount(b, a, n / 2, openings, uint64_t(1) << 32);
 
     return (win_as_whites + win_as_blacks) / n;
 }
@@ -49,7 +71,106 @@ bool better_than(strategy a, strategy b, double eps=0, unsigned n=10)
     return winrate(a, b, n) >= 0.5 - eps;
 }
 
-std::vector<std::vector<double>> winrate_matrix(const std::vector<strat::strategy_index> &strategies, unsigned repeat=100)
+// Sequential probability ratio test of "a is elo1 Elo stronger than b"
+// against "a is elo0 Elo stronger than b", with false positive rate alpha
+// and false negative rate beta. Games are played in colour swapped pairs
+// until the log likelihood ratio crosses a bound or max_games is reached.
+struct sprt_settings {
+    double elo0 = 0;
+    double elo1 = 50;
+    double alpha = 0.05;
+    double beta = 0.05;
+    unsigned min_games = 20; // before which no decision is taken
+    unsigned max_games = 2000;
+};
+
+enum sprt_decision { sprt_inconclusive, sprt_accept_elo0, sprt_accept_elo1 };
+
+struct sprt_result {
+    unsigned wins = 0, draws = 0, losses = 0; // of a
+    double llr = 0;
+    sprt_decision decision = sprt_inconclusive;
+
+    unsigned games() const { return wins + draws + losses; }
+    double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+
+    // variance of the result of one game
+    double variance() const
+    {
+        double s = score(), n = games();
+        if (n == 0)
+            return 0.25;
+        return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / n;
+    }
+
+    // Elo difference of a over b with the bounds of its 95% confidence interval.
+    double elo() const { return elo_from_score(score()); }
+    double elo_low() const { return elo_from_score(score() - 1.96 * std::sqrt(variance() / std::max(1u, games()))); }
+    double elo_high() const { return elo_from_score(score() + 1.96 * std::sqrt(variance() / std::max(1u, games()))); }
+
+    static double elo_from_score(double s)
+    {
+        s = std::clamp(s, 1e-3, 1 - 1e-3); // finite for all wins or losses
+        return -400 * std::log10(1 / s - 1);
+    }
+};
+
+double score_from_elo(double elo)
+{
+    return 1 / (1 + std::pow(10, -elo / 400));
+}
+
+// Normal approximation of the log likelihood ratio of the games so far.
+double sprt_llr(const sprt_result &r, const sprt_settings &s)
+{
+    double s0 = score_from_elo(s.elo0), s1 = score_from_elo(s.elo1);
+    // identical results would give a null variance, deterministic
+    // strategies replay the same games
+    double variance = std::max(r.variance(), 1e-3);
+    return r.games() * (s1 - s0) * (2 * r.score() - s0 - s1) / (2 * variance);
+}
+
+sprt_result sprt(strategy a, strategy b, const sprt_settings &s = sprt_settings(),
+    const std::vector<opening> *openings=nullptr)
+{
+    double lower = std::log(s.beta / (1 - s.alpha));
+    double upper = std::log((1 - s.beta) / s.alpha);
+
+    sprt_result r;
+    game g;
+    auto record = [&r](piece_color winner, piece_color a_color) {
+        if (winner == none)
+            r.draws++;
+        else if (winner == a_color)
+            r.wins++;
+        else
+            r.losses++;
+    };
+    while (r.games() + 2 <= s.max_games) {
+        trace::scope traced("sprt pair", "tournament", r.games() / 2);
+        for (piece_color a_color : {black, white}) {
+            random::stream stream(r.games());
+            g = start_position(openings, r.games() / 2);
+            record(a_color == black ? play(g, a, b) : play(g, b, a), a_color);
+        }
+
+        r.llr = sprt_llr(r, s);
+        if (r.games() < s.min_games)
+            continue;
+        if (r.llr >= upper) {
+            r.decision = sprt_accept_elo1;
+            break;
+        }
+        if (r.llr <= lower) {
+            r.decision = sprt_accept_elo0;
+            break;
+        }
+    }
+    return r;
+}
+
+std::vector<std::vector<double>> winrate_matrix(const std::vector<strat::strategy_index> &strategies, unsigned repeat=100,
+    const std::vector<opening> *openings=nullptr)
 {
     unsigned N = strategies.size();
 
@@ -62,7 +183,8 @@ std::vector<std::vector<double>> winrate_matrix(const std::vector<strat::strateg
     // build an anti 1 - x symmetric matrix
     for (unsigned i = 0; i < N; i++) {
         for (unsigned j = i + 1; j < N; j++) {
-            double win = winrate(strategies[i].strat, strategies[j].strat, repeat);
+            trace::scope traced("pairing", "tournament", i * N + j);
+            double win = winrate(strategies[i].strat, strategies[j].strat, repeat, openings);
             winrate_matrix[i][j] = win;
             winrate_matrix[j][i] = 1.0 - win;
         }
@@ -82,4 +204,87 @@ vector<double> accumulate_score(const std::vector<std::vector<double>> &winmatri
     return scores;
 }
 
+// Synthetic load on a game server: clients playing random moves as soon
+// as the server answers, through the text protocol, every session playing
+// its games in turn. The server plays white in even sessions.
+struct load_settings {
+    unsigned sessions = 100;
+    unsigned games = 1; // per session
+    int depth = 4;
+    unsigned move_ms = 100;
+};
+
+game_server::stats serve_load(const game_server::options &o, const load_settings &l)
+{
+    struct client {
+        game g;
+        piece_color server_color;
+        unsigned games_left;
+    };
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::map<std::string, client> clients;
+    unsigned playing = l.sessions;
+    auto open = [&](const std::string &id) {
+        return id + " new depth " + std::to_string(l.depth) + " time " + std::to_string(l.move_ms)
+            + " color " + io::to_string(clients[id].server_color);
+    };
+    auto play_random = [&](const std::string &id) {
+        game &g = clients[id].g;
+        bitpos p = strat::random_strategy(g, g.player(), g.possible_place_positions());
+        g.place_piece(p);
+        return id + " move " + io::to_string(pos::from_bitpos(p));
+    };
+
+    game_server *server = nullptr;
+    auto on_reply = [&](const std::string &line) {
+        std::istringstream in(line);
+        std::string id, word, arg, next;
+        in >> id >> word >> arg;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto i = clients.find(id);
+            if (i == clients.end())
+                return;
+            client &c = i->second;
+            pos p;
+            if (word == "ok") {
+                next = play_random(id);
+            } else if (word == "bestmove" && io::parse_pos(arg, p) && c.g.place_piece(p)) {
+                if (!c.g.is_game_over() && c.g.player() != c.server_color)
+                    next = play_random(id);
+            } else if (word == "gameover" && --c.games_left > 0) {
+                c.g = game();
+                next = open(id);
+            } else {
+                if (word != "gameover")
+                    std::cerr << "unexpected answer " << line << std::endl;
+                c.games_left = 0;
+                if (--playing == 0)
+                    finished.notify_all();
+            }
+        }
+        if (!next.empty())
+            server->execute(next);
+    };
+
+    game_server s(o, on_reply);
+    server = &s;
+    std::vector<std::string> opens;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (unsigned i = 0; i < l.sessions; i++) {
+            std::string id = "s";
+            id += std::to_string(i);
+            clients[id] = {game(), i % 2 ? black : white, l.games};
+            opens.push_back(open(id));
+        }
+    }
+    for (auto &line : opens)
+        s.execute(line);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return playing == 0; });
+    return s.statistics();
+}
+
 #endif
\ No newline at end of file
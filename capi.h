@@ -0,0 +1,238 @@
+#ifndef OTHELLO_CAPI_H
+#define OTHELLO_CAPI_H
+
+#include <memory>
+#include <mutex>
+#include <new>
+
+#include "othello.h"
+#include "othello_c.h"
+
+// Definitions of the C interface, built into libothello.so by
+// libothello.cpp. No exception crosses it: they become OTHELLO_FAILED.
+
+namespace othello::capi {
+
+bool valid(const othello_position &p)
+{
+    return (p.whites & p.blacks) == 0 && (p.player == OTHELLO_WHITE || p.player == OTHELLO_BLACK);
+}
+
+bool valid(const othello_position *positions, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        if (!valid(positions[i]))
+            return false;
+    return true;
+}
+
+game to_game(const othello_position &p)
+{
+    return game(board8x8(p.whites, p.blacks), p.player == OTHELLO_WHITE ? white : black);
+}
+
+othello_position from_game(const game &g)
+{
+    return {g.bitmap<white>(), g.bitmap<black>(), g.player() == white ? OTHELLO_WHITE : OTHELLO_BLACK};
+}
+
+score::batch_function evaluator(int e)
+{
+    switch (e) {
+    case OTHELLO_PIECES_DIFF:
+        return score::evaluate_batch<score::pieces_diff_terms>;
+    case OTHELLO_BORDERS_AND_CORNERS:
+        return score::evaluate_batch<score::borders_and_corners_terms>;
+    case OTHELLO_POSSIBLE_PLACE_POSITIONS:
+        return score::evaluate_batch<score::possible_place_positions_terms>;
+    case OTHELLO_STABLE_PIECES_DIFF:
+        return score::evaluate_batch<score::stable_pieces_diff_terms>;
+    case OTHELLO_MOBILITY_FRONTIER:
+        return score::evaluate_batch<score::mobility_frontier_terms>;
+    default:
+        return nullptr;
+    }
+}
+
+score::function scalar_evaluator(int e)
+{
+    switch (e) {
+    case OTHELLO_PIECES_DIFF:
+        return score::pieces_diff_score;
+    case OTHELLO_BORDERS_AND_CORNERS:
+        return score::pieces_diff_with_borders_and_corners;
+    case OTHELLO_POSSIBLE_PLACE_POSITIONS:
+        return score::possible_place_positions;
+    case OTHELLO_STABLE_PIECES_DIFF:
+        return score::stable_pieces_diff;
+    case OTHELLO_MOBILITY_FRONTIER:
+        return score::mobility_frontier;
+    default:
+        return nullptr;
+    }
+}
+
+template<typename body>
+int guarded(body f)
+{
+    try {
+        return f();
+    } catch (...) {
+        return OTHELLO_FAILED;
+    }
+}
+
+}
+
+// Strategies keep state between moves, the searcher its table and line,
+// hence one call at a time per engine.
+struct othello_engine {
+    std::mutex mutex;
+    othello::strategy strat;
+    std::unique_ptr<othello::search::endgame_solver> solver;
+};
+
+extern "C" {
+
+OTHELLO_API int othello_abi_version(void)
+{
+    return OTHELLO_ABI_VERSION;
+}
+
+OTHELLO_API void othello_seed(uint64_t seed)
+{
+    othello::random::seed(seed);
+}
+
+OTHELLO_API void othello_initial_position(othello_position *p)
+{
+    *p = othello::capi::from_game(othello::game());
+}
+
+OTHELLO_API int othello_play(othello_position *positions, const uint64_t *moves, size_t n)
+{
+    using namespace othello;
+    return capi::guarded([&] {
+        for (size_t i = 0; i < n; i++) {
+            if (!capi::valid(positions[i]) || !is_bitpos_valid(moves[i]))
+                return OTHELLO_INVALID;
+            game g = capi::to_game(positions[i]);
+            if (!g.place_piece(moves[i]))
+                return OTHELLO_INVALID;
+            positions[i] = capi::from_game(g);
+        }
+        return OTHELLO_OK;
+    });
+}
+
+OTHELLO_API int othello_moves(const othello_position *positions, size_t n, uint64_t *moves)
+{
+    using namespace othello;
+    if (!capi::valid(positions, n))
+        return OTHELLO_INVALID;
+    for (size_t i = 0; i < n; i++)
+        moves[i] = capi::to_game(positions[i]).possible_place_positions().bitmap;
+    return OTHELLO_OK;
+}
+
+OTHELLO_API int othello_evaluate(const othello_position *positions, size_t n, int evaluator, int32_t *scores)
+{
+    using namespace othello;
+    score::batch_function evaluate = capi::evaluator(evaluator);
+    if (!evaluate || !capi::valid(positions, n))
+        return OTHELLO_INVALID;
+    // in chunks of one batch, their moves generated together
+    score::batch b;
+    int chunk[score::batch::capacity];
+    for (size_t i = 0; i < n; i += b.size) {
+        b.size = 0;
+        while (b.size < score::batch::capacity && i + b.size < n)
+            b.push(capi::to_game(positions[i + b.size]));
+        b.generate_moves();
+        evaluate(b, chunk);
+        for (int j = 0; j < b.size; j++)
+            scores[i + j] = chunk[j];
+    }
+    return OTHELLO_OK;
+}
+
+OTHELLO_API othello_engine *othello_engine_new(int strategy, int depth, int evaluator)
+{
+    using namespace othello;
+    score::function scoref = capi::scalar_evaluator(evaluator);
+    bool searches = strategy != OTHELLO_RANDOM && strategy != OTHELLO_SOLVE;
+    if (searches && (!scoref || (strategy != OTHELLO_MAXIMIZE && depth < 1)))
+        return nullptr;
+    if (strategy == OTHELLO_PROBCUT && evaluator != OTHELLO_MOBILITY_FRONTIER)
+        return nullptr; // the only fitted probcut table
+
+    othello_engine *e = new (std::nothrow) othello_engine;
+    if (!e)
+        return nullptr;
+    try {
+        switch (strategy) {
+        case OTHELLO_RANDOM:
+            e->strat = strat::random_strategy;
+            break;
+        case OTHELLO_MAXIMIZE:
+            e->strat = strat::maximize_score_strategy(scoref);
+            break;
+        case OTHELLO_MINMAX:
+            e->strat = strat::minmax_strategy(depth, scoref);
+            break;
+        case OTHELLO_ALPHABETA:
+            e->strat = strat::alphabeta_strategy(depth, scoref);
+            break;
+        case OTHELLO_PROBCUT:
+            e->strat = strat::probcut_strategy(depth);
+            break;
+        case OTHELLO_SEARCH:
+            e->strat = strat::search_strategy(std::make_shared<search::searcher>(search::settings{
+                .depth = depth,
+                .score = scoref,
+                .transpositions = std::make_shared<search::transposition_table>(),
+            }));
+            break;
+        case OTHELLO_SOLVE:
+            e->solver = std::make_unique<search::endgame_solver>();
+            break;
+        default:
+            delete e;
+            return nullptr;
+        }
+    } catch (...) {
+        delete e;
+        return nullptr;
+    }
+    return e;
+}
+
+OTHELLO_API void othello_engine_free(othello_engine *e)
+{
+    delete e;
+}
+
+OTHELLO_API int othello_best_moves(othello_engine *e, const othello_position *positions, size_t n,
+    uint64_t *moves)
+{
+    using namespace othello;
+    if (!e || !capi::valid(positions, n))
+        return OTHELLO_INVALID;
+    return capi::guarded([&] {
+        std::lock_guard<std::mutex> lock(e->mutex);
+        for (size_t i = 0; i < n; i++) {
+            game g = capi::to_game(positions[i]);
+            if (g.is_game_over())
+                moves[i] = 0;
+            else if (e->solver)
+                moves[i] = e->solver->solve(g).best;
+            else
+                moves[i] = e->strat(g, g.player(), g.possible_place_positions());
+        }
+        return OTHELLO_OK;
+    });
+}
+
+}
+
+#endif // OTHELLO_CAPI_H
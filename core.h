@@ -16,72 +16,18 @@ class game {
     board8x8 board;
     piece_color next_player;
 
-    template<piece_color player>
-    void flip_pieces_in_direction(bitpos p, direction d)
-    {
-        if (!can_piece_surround_in_direction<player>(p, d))
-            return;
-
-        // flip pieces
-        for (bitpos np = next_bitpos(p, d);
-            is_bitpos_valid(np) && board.has<opposite(player)>(np);
-            np = next_bitpos(np, d))
-        {
-            board.set(np, player);
-        }
-    }
-
-    template<piece_color player>
-    bool can_piece_surround_in_direction(bitpos p, direction d) const
-    {
-        int count = 0;
-        for (bitpos np = next_bitpos(p, d);
-            is_bitpos_valid(np);
-            np = next_bitpos(np, d))
-        {
-            if (board.has<player>(np))
-                return count > 0;
-
-            if (!board.has<opposite(player)>(np)) // if none
-                return false;
-
-            count++;
-        }
-        return false;
-    }
-
     void flip_player() {
         next_player = opposite(next_player);
     }
 
     bool unchecked_can_play(bitpos p, piece_color player_) const
     {
-        if (player_ == white) {
-            for (direction d : directions::all) {
-                if (can_piece_surround_in_direction<white>(p, d))
-                    return true;
-            }
-        } else { // black
-            for (direction d : directions::all) {
-                if (can_piece_surround_in_direction<black>(p, d))
-                    return true;
-            }
-        }
-
-        return false;
+        return board.flips(p, player_) != 0;
     }
 
     bool unchecked_place_piece(bitpos p)
     {
-        if (player() == white) {
-            for (direction d : directions::all)
-                flip_pieces_in_direction<white>(p, d);
-        } else { // black
-            for (direction d : directions::all)
-                flip_pieces_in_direction<black>(p, d);
-        }
-
-        board.set(p, player());
+        board.set(board.flips(p, player()) | p, player());
 
         if (player_can_place_any_piece(opposite(player())))
             flip_player();
@@ -102,18 +48,35 @@ public:
     {
     }
 
+    // Arbitrary position; the turn passes if player cannot move but the
+    // opponent can, as it would have during the game.
+    game(const board8x8 &b, piece_color player)
+        : board(b), next_player(player)
+    {
+        if (!player_can_place_any_piece(player) && player_can_place_any_piece(opposite(player)))
+            flip_player();
+    }
+
     game &operator=(const game &o) {
         board = o.board;
         next_player = o.next_player;
         return *this;
     }
 
+    bool operator==(const game &o) const {
+        return board == o.board && next_player == o.next_player;
+    }
+
     piece_color operator[](bitpos p) const {
         return board.get(p);
     }
 
     piece_color player() const { return next_player; }
 
+    uint64 hash() const {
+        return board.hash() ^ (next_player == white ? 0x5bd1e9955bd1e995ULL : 0);
+    }
+
     void init()
     {
         board.reset();
@@ -129,7 +92,7 @@ public:
 
     bool can_play(bitpos p, piece_color player_) const
     {
-        if (!is_bitpos_valid(p))
+        if (!is_bitpos_valid(p) || !board.has<none>(p))
             return false;
         
         return unchecked_can_play(p, player_);
@@ -161,21 +124,12 @@ public:
 
     positions possible_place_positions() const
     {
-        positions possible_positions = {0};
-        for (bitpos p : positions{board.nones()}) {
-            if (can_play(p, player()))
-                possible_positions.set_bit(p);
-        }
-        return possible_positions;
+        return {board.moves(player())};
     }
 
     bool player_can_place_any_piece(piece_color pc) const
     {
-        for (bitpos p : positions{board.nones()}) {
-            if (can_play(p, pc))
-                return true;
-        }
-        return false;
+        return board.moves(pc) != 0;
     }
 
     bool is_game_over() const
@@ -197,6 +151,31 @@ public:
         return board.count<color>(mask);
     }
 
+    template<piece_color color>
+    bitmap8x8 bitmap() const {
+        return board.bitmap<color>();
+    }
+
+    template<piece_color color>
+    bitmap8x8 stable() const {
+        return board.stable<color>();
+    }
+
+    template<piece_color color>
+    bitmap8x8 moves() const {
+        return board.moves<color>();
+    }
+
+    template<piece_color color>
+    bitmap8x8 potential_moves() const {
+        return board.potential_moves<color>();
+    }
+
+    template<piece_color color>
+    bitmap8x8 frontier() const {
+        return board.frontier<color>();
+    }
+
 };
 
 }
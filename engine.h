@@ -0,0 +1,181 @@
+#ifndef OTHELLO_ENGINE_H
+#define OTHELLO_ENGINE_H
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#include "core.h"
+#include "io.h"
+#include "pool.h"
+#include "search.h"
+
+namespace othello {
+
+// Long running engine speaking a line protocol, one command per line:
+//
+//   new                      starts a new game
+//   position <snapshot>      sets the position, in the io::to_string format
+//   move <pos> [<pos> ...]   plays the moves on the current position
+//   go [depth N] [time MS]   searches the current position in background,
+//                            then answers "bestmove <pos> score S depth D pv ..."
+//   stop                     interrupts the running search, which answers
+//   show                     prints the current position snapshot
+//   isready                  answers "readyok" once no search is running
+//   quit                     stops and exits
+//
+// Other commands answer "ok" or "error <reason>". The transposition table
+// and the search thread are kept across games.
+class engine {
+    search::settings config;
+    search::searcher searcher;
+    thread_pool pool{1};
+    game position;
+
+    std::atomic<bool> stop_flag{false};
+    std::future<void> running;
+
+    std::ostream &out;
+    std::mutex out_mutex;
+
+    void reply(const std::string &s)
+    {
+        std::lock_guard<std::mutex> lock(out_mutex);
+        out << s << std::endl;
+    }
+
+    void wait_search()
+    {
+        if (running.valid())
+            running.get();
+    }
+
+    void go(std::istringstream &args)
+    {
+        search::limits l;
+        std::string key;
+        long value;
+        while (args >> key >> value) {
+            if (key == "depth") {
+                l.depth = value;
+            } else if (key == "time") {
+                l.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(value);
+                if (!l.depth)
+                    l.depth = 60;
+            } else {
+                reply("error unknown go limit " + key);
+                return;
+            }
+        }
+
+        if (position.is_game_over()) {
+            reply("error game over, winner " + io::to_string(position.winner()));
+            return;
+        }
+
+        stop_flag = false;
+        l.stop = &stop_flag;
+        game g = position;
+        running = pool.submit([this, g, l]() {
+            search::result r = searcher.search(g, g.possible_place_positions(), l);
+            bitpos best = r.best_move();
+            if (!best) // stopped before the first iteration, any move will do
+                best = *g.possible_place_positions().begin();
+            reply("bestmove " + io::to_string(pos::from_bitpos(best))
+                + " score " + std::to_string(r.score)
+                + " depth " + std::to_string(r.depth)
+                + " pv " + io::moves_to_string(r.pv));
+        });
+    }
+
+    void move(std::istringstream &args)
+    {
+        std::string token;
+        game g = position;
+        while (args >> token) {
+            pos p;
+            if (!io::parse_pos(token, p) || !g.place_piece(p)) {
+                reply("error illegal move " + token);
+                return;
+            }
+        }
+        position = g;
+        reply("ok");
+    }
+
+    static search::settings with_table(search::settings s)
+    {
+        if (!s.transpositions)
+            s.transpositions = std::make_shared<search::transposition_table>();
+        return s;
+    }
+
+public:
+    explicit engine(std::ostream &o, const search::settings &s = search::settings())
+        : config(with_table(s)), searcher(config), out(o)
+    {}
+
+    ~engine()
+    {
+        stop_flag = true;
+        wait_search();
+    }
+
+    // Runs one command, returns false on quit.
+    bool execute(const std::string &line)
+    {
+        std::istringstream args(line);
+        std::string command;
+        if (!(args >> command))
+            return true;
+
+        if (command == "stop" || command == "quit") {
+            stop_flag = true;
+            wait_search();
+            return command != "quit";
+        }
+
+        // any other command waits for the running search
+        wait_search();
+        if (command == "new") {
+            position.init();
+            reply("ok");
+        } else if (command == "position") {
+            std::string snapshot;
+            std::getline(args >> std::ws, snapshot);
+            if (io::parse_game(snapshot, position))
+                reply("ok");
+            else
+                reply("error invalid position");
+        } else if (command == "move") {
+            move(args);
+        } else if (command == "go") {
+            go(args);
+        } else if (command == "show") {
+            reply(io::to_string(position));
+        } else if (command == "isready") {
+            reply("readyok");
+        } else {
+            reply("error unknown command " + command);
+        }
+        return true;
+    }
+
+    // Serves until quit, or until the end of the input once the last
+    // search has answered.
+    void run(std::istream &in)
+    {
+        std::string line;
+        while (std::getline(in, line) && execute(line)) {}
+        wait_search();
+    }
+};
+
+}
+
+#endif // OTHELLO_ENGINE_H
@@ -4,6 +4,8 @@
 #include "core.h"
 
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <sstream>
 
@@ -70,11 +72,47 @@ std::string to_string(const othello::game &game)
     return s;
 }
 
-othello::game parse_game(std::string line)
+std::string moves_to_string(const std::vector<bitpos> &moves)
 {
-    game g;
+    std::string s;
+    for (bitpos p : moves) {
+        if (!s.empty())
+            s += ' ';
+        s += to_string(pos::from_bitpos(p));
+    }
+    return s;
+}
+
+// Reads a snapshot written by to_string(const game &), without allocating.
+bool parse_game(std::string_view line, othello::game &g)
+{
+    if (line.size() < 66 || line[1] != ':')
+        return false;
+
+    piece_color player = line[0] == 'w' ? white : line[0] == 'b' ? black : none;
+    if (player == none)
+        return false;
+
+    board8x8 board;
+    bitpos p = 1;
+    for (char c : line.substr(2, 64)) {
+        if (c == 'w')
+            board.set_white(p);
+        else if (c == 'b')
+            board.set_black(p);
+        else if (c != '.')
+            return false;
+        p <<= 1;
+    }
+
+    // only trailing blanks are allowed after the board
+    for (char c : line.substr(66)) {
+        if (c != ' ' && c != '\t' && c != '\r')
+            return false;
+    }
 
-    return g;
+    g = game(board, player);
+    return true;
 }
 
 bool parse_pos(std::string s, othello::pos &pos)
@@ -97,6 +135,39 @@ bool parse_pos(std::string s, othello::pos &pos)
     return false;
 }
 
+// Two characters square, column letter and row digit in either order.
+constexpr bool parse_square(char a, char b, othello::pos &pos)
+{
+    if (a >= '1' && a <= '8')
+        std::swap(a, b);
+    if (a < 'a' || a > 'h' || b < '1' || b > '8')
+        return false;
+    pos = {a - 'a', b - '1'};
+    return true;
+}
+
+// Compact binary game records: a magic header, then one byte per move
+// holding the square index, with the high bit set on the last move of
+// each game. Records can be found from any offset by looking for the
+// next end of game byte.
+constexpr char binary_games_magic[8] = {'O', 'T', 'H', 'G', 'A', 'M', 'E', 'S'};
+constexpr unsigned char binary_last_move = 0x80;
+
+void write_binary_header(std::ostream &out)
+{
+    out.write(binary_games_magic, sizeof(binary_games_magic));
+}
+
+void write_binary_game(std::ostream &out, const std::vector<bitpos> &moves)
+{
+    for (unsigned i = 0; i < moves.size(); i++) {
+        unsigned char c = util::to_index(moves[i]);
+        if (i + 1 == moves.size())
+            c |= binary_last_move;
+        out.put(c);
+    }
+}
+
 std::vector<bitpos> parse_game_positions(std::string line)
 {
     std::vector<bitpos> replay;
@@ -0,0 +1,180 @@
+#ifndef OTHELLO_JOBS_H
+#define OTHELLO_JOBS_H
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace othello::jobs {
+
+namespace fs = std::filesystem;
+
+// Set of jobs shared by worker processes through a directory, which may
+// be on a network file system mounted by several hosts:
+//
+//   pending/<id>            jobs not claimed yet, one line each
+//   claimed/<id>@<worker>   jobs being run, claimed by renaming them
+//   done/<id>               results, written aside then renamed in place
+//   setup                   key value lines describing the job set
+//
+// Every state change is a rename, so a job is claimed by one worker only
+// and a result is either complete or absent. The directory is its own
+// checkpoint: a coordinator restarted after a crash requeues the claims
+// of the dead workers and carries on.
+class queue {
+    fs::path root;
+
+    static std::string read_file(const fs::path &p)
+    {
+        std::ifstream in(p);
+        std::stringstream s;
+        s << in.rdbuf();
+        return s.str();
+    }
+
+    // Written under a unique temporary name, then renamed to p.
+    void write_file(const fs::path &p, const std::string &content) const
+    {
+        fs::path tmp = root / "tmp" / (p.filename().string() + "." + worker_name());
+        {
+            std::ofstream out(tmp);
+            out << content;
+        }
+        fs::rename(tmp, p);
+    }
+
+    static std::string id_of_claim(const fs::path &claim)
+    {
+        std::string name = claim.filename().string();
+        return name.substr(0, name.find('@'));
+    }
+
+public:
+    explicit queue(const fs::path &dir)
+        : root(dir)
+    {}
+
+    // Host and process of the calling worker.
+    static std::string worker_name()
+    {
+        char host[256] = "localhost";
+        gethostname(host, sizeof(host) - 1);
+        return std::string(host) + "." + std::to_string(getpid());
+    }
+
+    static std::string make_id(unsigned n)
+    {
+        std::ostringstream s;
+        s << std::setw(8) << std::setfill('0') << n;
+        return s.str();
+    }
+
+    void create(const std::vector<std::pair<std::string, std::string>> &setup)
+    {
+        for (const char *sub : {"pending", "claimed", "done", "tmp"})
+            fs::create_directories(root / sub);
+        std::string content;
+        for (auto &kv : setup)
+            content += kv.first + " " + kv.second + "\n";
+        write_file(root / "setup", content);
+    }
+
+    bool exists() const
+    {
+        return fs::exists(root / "setup");
+    }
+
+    std::map<std::string, std::string> setup() const
+    {
+        std::map<std::string, std::string> values;
+        std::istringstream in(read_file(root / "setup"));
+        std::string key, value;
+        while (in >> key && std::getline(in >> std::ws, value))
+            values[key] = value;
+        return values;
+    }
+
+    void add(const std::string &id, const std::string &job)
+    {
+        write_file(root / "pending" / id, job);
+    }
+
+    // Claims any pending job, false when there is none left.
+    bool claim(std::string &id, std::string &job, const std::string &worker = worker_name())
+    {
+        for (auto &entry : fs::directory_iterator(root / "pending")) {
+            fs::path claimed = root / "claimed" / (entry.path().filename().string() + "@" + worker);
+            std::error_code lost; // to another worker
+            fs::rename(entry.path(), claimed, lost);
+            if (lost)
+                continue;
+            fs::last_write_time(claimed, fs::file_time_type::clock::now(), lost);
+            id = entry.path().filename().string();
+            job = read_file(claimed);
+            return true;
+        }
+        return false;
+    }
+
+    void complete(const std::string &id, const std::string &result, const std::string &worker = worker_name())
+    {
+        write_file(root / "done" / id, result);
+        std::error_code ignored; // requeued meanwhile
+        fs::remove(root / "claimed" / (id + "@" + worker), ignored);
+    }
+
+    // Puts back the claims for which dead(worker, age) holds, unless they
+    // completed meanwhile. Returns the number of requeued jobs.
+    template<typename predicate>
+    unsigned requeue(predicate dead)
+    {
+        unsigned n = 0;
+        auto now = fs::file_time_type::clock::now();
+        for (auto &entry : fs::directory_iterator(root / "claimed")) {
+            std::string name = entry.path().filename().string();
+            std::error_code gone;
+            auto claimed_at = fs::last_write_time(entry.path(), gone);
+            auto age = std::chrono::duration_cast<std::chrono::seconds>(now - claimed_at);
+            if (gone || !dead(name.substr(name.find('@') + 1), age))
+                continue;
+            std::string id = id_of_claim(entry.path());
+            if (fs::exists(root / "done" / id))
+                fs::remove(entry.path(), gone);
+            else
+                fs::rename(entry.path(), root / "pending" / id, gone);
+            n += !gone;
+        }
+        return n;
+    }
+
+    unsigned count(const char *state) const
+    {
+        unsigned n = 0;
+        for (auto &entry : fs::directory_iterator(root / state)) {
+            (void)entry;
+            n++;
+        }
+        return n;
+    }
+
+    // Results by job id, in id order.
+    std::map<std::string, std::string> results() const
+    {
+        std::map<std::string, std::string> r;
+        for (auto &entry : fs::directory_iterator(root / "done"))
+            r[entry.path().filename().string()] = read_file(entry.path());
+        return r;
+    }
+};
+
+}
+
+#endif // OTHELLO_JOBS_H
@@ -0,0 +1,2 @@
+// libothello.so: the C interface of othello_c.h
+#include "capi.h"
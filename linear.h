@@ -0,0 +1,122 @@
+#ifndef OTHELLO_LINEAR_H
+#define OTHELLO_LINEAR_H
+
+#include "types.h"
+
+namespace othello::score {
+
+// Evaluators declared as weighted sums of bitboard features, e.g.
+//
+//   linear<term<4, mobility>, term<32, discs<mask::corners>>>::eval(g)
+//
+// Every feature is the white value minus the black one and states the
+// intermediates it reads. The sum collects these needs at compile time
+// and computes each intermediate once, whichever terms share it, before
+// adding the terms up in a single inlined expression.
+namespace needs {
+    constexpr unsigned discs = 0; // always known
+    constexpr unsigned moves = 1 << 0; // of both players
+    constexpr unsigned player_moves = 1 << 1; // of the player to move only
+    constexpr unsigned stable = 1 << 2;
+}
+
+struct intermediates {
+    bitmap8x8 whites, blacks, empty;
+    bitmap8x8 white_moves, black_moves;
+    bitmap8x8 player_moves;
+    bitmap8x8 white_stable, black_stable;
+    bool white_to_move;
+};
+
+// position is a game, or any type with the same bitmap, player, moves and
+// stable members.
+template<unsigned need, typename position>
+intermediates compute(const position &g)
+{
+    intermediates x = {};
+    x.whites = g.template bitmap<white>();
+    x.blacks = g.template bitmap<black>();
+    x.empty = ~(x.whites | x.blacks);
+    x.white_to_move = g.player() == white;
+    if constexpr ((need & needs::moves) != 0) {
+        x.white_moves = g.template moves<white>();
+        x.black_moves = g.template moves<black>();
+        x.player_moves = x.white_to_move ? x.white_moves : x.black_moves;
+    } else if constexpr ((need & needs::player_moves) != 0) {
+        x.player_moves = x.white_to_move ? g.template moves<white>() : g.template moves<black>();
+    }
+    if constexpr ((need & needs::stable) != 0) {
+        x.white_stable = g.template stable<white>();
+        x.black_stable = g.template stable<black>();
+    }
+    return x;
+}
+
+// Discs inside mask.
+template<bitmap8x8 mask>
+struct discs {
+    static constexpr unsigned need = needs::discs;
+    static int value(const intermediates &x) { return popcount(x.whites & mask) - popcount(x.blacks & mask); }
+};
+
+// Legal moves.
+struct mobility {
+    static constexpr unsigned need = needs::moves;
+    static int value(const intermediates &x) { return popcount(x.white_moves) - popcount(x.black_moves); }
+};
+
+// Legal moves of the player to move, negative for black.
+struct player_mobility {
+    static constexpr unsigned need = needs::player_moves;
+    static int value(const intermediates &x)
+    {
+        return x.white_to_move ? popcount(x.player_moves) : -popcount(x.player_moves);
+    }
+};
+
+// Empty squares next to opponent discs: moves that may become legal.
+struct potential_mobility {
+    static constexpr unsigned need = needs::discs;
+    static int value(const intermediates &x)
+    {
+        return popcount(neighbours(x.blacks) & x.empty) - popcount(neighbours(x.whites) & x.empty);
+    }
+};
+
+// Discs touching an empty square.
+struct frontier {
+    static constexpr unsigned need = needs::discs;
+    static int value(const intermediates &x)
+    {
+        bitmap8x8 next_to_empty = neighbours(x.empty);
+        return popcount(next_to_empty & x.whites) - popcount(next_to_empty & x.blacks);
+    }
+};
+
+// Discs that cannot be flipped anymore.
+struct stability {
+    static constexpr unsigned need = needs::stable;
+    static int value(const intermediates &x) { return popcount(x.white_stable) - popcount(x.black_stable); }
+};
+
+template<int weight_, typename feature_>
+struct term {
+    static constexpr int weight = weight_;
+    typedef feature_ feature;
+};
+
+template<typename... terms>
+struct linear {
+    static constexpr unsigned need = (terms::feature::need | ... | 0u);
+
+    template<typename position>
+    static int eval(const position &g)
+    {
+        intermediates x = compute<need>(g);
+        return (0 + ... + (terms::weight * terms::feature::value(x)));
+    }
+};
+
+}
+
+#endif // OTHELLO_LINEAR_H
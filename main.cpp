@@ -1,11 +1,14 @@
 
 #include <algorithm>
+#include <chrono>
+#include <climits>
 #include <cmath>
 #include <ctime>
 #include <functional>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <mutex>
 
 #include "othello.h"
 #include "colors.h"
@@ -65,20 +68,44 @@ void print_othello_board(const othello::game &game, const othello::pos &lastpos)
     cout << endl;
 }
 
+static const othello::search::settings search_settings = {
+    .depth = 8,
+    .probcut_threshold = 1.0,
+    .transpositions = make_shared<othello::search::transposition_table>(),
+};
+static auto searcher = make_shared<othello::search::searcher>(search_settings);
+static auto ponder = make_shared<othello::search::ponderer>(search_settings);
+bool arg_ponder = false;
+
+void print_principal_variation(const othello::game &, const othello::search::result &r)
+{
+    cout << "pv [" << r.score << " @ " << r.depth << "]: "
+        << othello::io::moves_to_string(r.pv) << endl;
+}
+
 void parse_command(string s, const othello::game &game) {
     if (s == "snapshot" || s == "snap") {
         cout << io::to_string(game) << endl;
+    } else if (s == "pv") {
+        print_principal_variation(game, searcher->last());
     }
 }
 
 othello::bitpos human_strategy(const othello::game &game, piece_color player, othello::positions possible_positions)
 {
+    // search the engine replies while the human thinks
+    if (arg_ponder)
+        ponder->start(game, searcher->expected_line(game));
+
     othello::pos p;
     while (1) {
         cout << "[" << to_symbol(player) << "] play position: ";
 
         string s;
-        getline(cin, s);
+        if (!getline(cin, s)) {
+            cout << endl;
+            exit(0); // end of input
+        }
         if (!othello::io::parse_pos(s, p)) {
             parse_command(s, game);
             continue;
@@ -98,7 +125,8 @@ static const vector<othello::strat::strategy_index> strategies = {
     {"minmax 2", othello::strat::minmax2},
     {"minmax 4", othello::strat::minmax4},
     {"difficult", othello::strat::start_random},
-    {"minmax 8", othello::strat::minmax8}
+    {"minmax 8", othello::strat::minmax8},
+    {"probcut 8 with pv", othello::strat::search_strategy(searcher, ponder)}
 };
 
 othello::strategy make_strategy_from_index(othello::piece_color color, unsigned index)
@@ -134,6 +162,21 @@ void print_help()
 {
     cout << "-b and -h arguments lets select the AI strategy for each player:" << endl;
     print_strategy_indexes();
+    cout << "--pv prints the line expected by the searching strategies after each of their moves," << endl;
+    cout << "also available as the 'pv' command while playing." << endl;
+    cout << "--ponder lets the searching strategies think while the human player does." << endl;
+    cout << "--engine serves the line protocol of othello::engine on the standard input and output." << endl;
+    cout << "--serve hosts many games at once, with the line protocol of othello::game_server on the standard" << endl;
+    cout << "  input and output, searching on all cores. --depth N sets the default search depth." << endl;
+    cout << "--analyze FILE searches every snapshot line of FILE (- for the standard input) on all cores," << endl;
+    cout << "  printing the results in input order. --depth N sets the search depth (default 8)." << endl;
+    cout << "--verify FILE replays every recorded game of FILE, one text game per line or binary records," << endl;
+    cout << "  and reports the corrupt ones." << endl;
+    cout << "--review FILE searches every position of the games logged by --output in FILE on all cores" << endl;
+    cout << "  and reports the score each played move lost against the best one, flagging the blunders." << endl;
+    cout << "--seed N replays the random choices of an earlier game, whose seed is printed at start." << endl;
+    cout << "--trace FILE writes a timeline of the games, moves and searches to FILE on exit," << endl;
+    cout << "  in the Chrome trace event format (chrome://tracing or ui.perfetto.dev)." << endl;
 }
 
 vector<string> argv_to_args(int argc, char* argv[])
@@ -156,6 +199,95 @@ unsigned int parse_strategy_index_arg(const string &arg)
 unsigned int arg_white_strategy = 0;
 unsigned int arg_black_strategy = 0;
 string arg_output_log_in_file = "";
+bool arg_print_pv = false;
+bool arg_engine = false;
+bool arg_serve = false;
+string arg_analyze = "";
+string arg_verify = "";
+string arg_review = "";
+int arg_depth = 0;
+string arg_trace = "";
+uint64_t arg_seed = 0;
+bool arg_has_seed = false;
+
+int verify_records(const string &filename)
+{
+    othello::mapped_file file(filename);
+    if (!file.begin()) {
+        cerr << "cannot map " << filename << endl;
+        return 1;
+    }
+
+    othello::thread_pool pool;
+    auto start = chrono::steady_clock::now();
+    auto report = othello::verify_games(file.begin(), file.end(), pool);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    sort(report.corrupt.begin(), report.corrupt.end());
+    cout << "games: " << report.games << ", moves: " << report.moves << endl;
+    cout << "draws: " << report.wins[0] << ", white wins: " << report.wins[1]
+        << ", black wins: " << report.wins[2] << ", incomplete: " << report.incomplete << endl;
+    cout << "corrupt: " << report.corrupt.size() << endl;
+    for (unsigned i = 0; i < report.corrupt.size() && i < 10; i++)
+        cout << "\tat offset " << report.corrupt[i] << endl;
+    cout << "throughput: " << report.games / seconds << " games/s, "
+        << report.moves / seconds << " moves/s, "
+        << file.size() / seconds / (1 << 20) << " MB/s on " << pool.size() << " threads" << endl;
+    return report.corrupt.empty() ? 0 : 1;
+}
+
+// a move losing more than a corner is worth is a blunder
+const long long blunder_drop = 32;
+
+string score_string(long long score)
+{
+    if (score == INT_MAX)
+        return "white wins";
+    if (score == INT_MIN)
+        return "black wins";
+    return to_string(score);
+}
+
+int review_games(const string &filename, const othello::search::settings &settings)
+{
+    ifstream file(filename);
+    if (!file) {
+        cerr << "cannot read " << filename << endl;
+        return 1;
+    }
+
+    othello::thread_pool pool;
+    string line;
+    while (getline(file, line)) {
+        auto moves = othello::io::parse_game_positions(line);
+        if (moves.empty())
+            continue;
+
+        vector<othello::move_review> reviews;
+        auto start = chrono::steady_clock::now();
+        bool legal = othello::review_game(moves, settings, pool, reviews);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        unsigned blunders = 0;
+        for (unsigned i = 0; i < reviews.size(); i++) {
+            const auto &r = reviews[i];
+            bool blunder = r.drop >= blunder_drop;
+            blunders += blunder;
+            cout << i + 1 << ". " << othello::io::to_string(r.player)
+                << " " << othello::io::to_string(othello::pos::from_bitpos(r.played))
+                << " (" << score_string(r.played_score) << ")"
+                << " best " << othello::io::to_string(othello::pos::from_bitpos(r.best))
+                << " (" << score_string(r.best_score) << ") drop "
+                << (r.drop >= INT_MAX ? "the game" : to_string(r.drop))
+                << (blunder ? " blunder" : "") << endl;
+        }
+        if (!legal)
+            cout << "illegal move " << reviews.size() + 1 << endl;
+        cout << blunders << " blunders in " << reviews.size() << " moves, reviewed in "
+            << seconds << " s" << endl << endl;
+    }
+    return 0;
+}
 
 bool parse_args(vector<string> args)
 {
@@ -184,6 +316,51 @@ bool parse_args(vector<string> args)
                 return false;
             }
             arg_output_log_in_file = args[++i];
+        } else if (args[i] == "--pv") {
+            arg_print_pv = true;
+        } else if (args[i] == "--ponder") {
+            arg_ponder = true;
+        } else if (args[i] == "--engine") {
+            arg_engine = true;
+        } else if (args[i] == "--serve") {
+            arg_serve = true;
+        } else if (args[i] == "--analyze") {
+            if (i + 1 == args.size()) {
+                cerr << "analyze argument requires a file of snapshots, - for the standard input" << endl;
+                return false;
+            }
+            arg_analyze = args[++i];
+        } else if (args[i] == "--verify") {
+            if (i + 1 == args.size()) {
+                cerr << "verify argument requires a game record file" << endl;
+                return false;
+            }
+            arg_verify = args[++i];
+        } else if (args[i] == "--review") {
+            if (i + 1 == args.size()) {
+                cerr << "review argument requires a game log file" << endl;
+                return false;
+            }
+            arg_review = args[++i];
+        } else if (args[i] == "--depth") {
+            if (i + 1 == args.size()) {
+                cerr << "depth argument requires a number of plies" << endl;
+                return false;
+            }
+            arg_depth = atoi(args[++i].c_str());
+        } else if (args[i] == "--seed") {
+            if (i + 1 == args.size()) {
+                cerr << "seed argument requires a number" << endl;
+                return false;
+            }
+            arg_seed = strtoull(args[++i].c_str(), nullptr, 10);
+            arg_has_seed = true;
+        } else if (args[i] == "--trace") {
+            if (i + 1 == args.size()) {
+                cerr << "trace argument requires an output file" << endl;
+                return false;
+            }
+            arg_trace = args[++i];
         } else {
             // ignore argument ?
             cerr << "unknow argument " << args[i] << endl;
@@ -199,8 +376,67 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    srand(time(nullptr));
+    othello::random::seed(arg_has_seed ? arg_seed : time(nullptr));
+
+    if (!arg_trace.empty()) {
+        othello::trace::start();
+        atexit([]() {
+            ofstream file(arg_trace);
+            othello::trace::dump(file);
+        });
+    }
+
+    othello::search::settings settings = search_settings;
+    if (arg_depth > 0)
+        settings.depth = arg_depth;
+
+    // the protocols own the standard output
+    if (arg_engine || !arg_analyze.empty() || !arg_review.empty())
+        clog << "transposition table: " << settings.transpositions->allocation().describe() << endl;
+
+    if (arg_engine) {
+        othello::engine engine(cout, settings);
+        engine.run(cin);
+        return 0;
+    }
+
+    if (arg_serve) {
+        mutex out_mutex;
+        othello::game_server server({.search = settings}, [&out_mutex](const string &line) {
+            lock_guard<mutex> lock(out_mutex);
+            cout << line << endl;
+        });
+        clog << "server tables: " << server.describe_table() << endl;
+        server.run(cin);
+        return 0;
+    }
+
+    if (!arg_verify.empty())
+        return verify_records(arg_verify);
+
+    if (!arg_review.empty())
+        return review_games(arg_review, settings);
+
+    if (!arg_analyze.empty()) {
+        othello::thread_pool pool;
+        ifstream file;
+        if (arg_analyze != "-") {
+            file.open(arg_analyze);
+            if (!file) {
+                cerr << "cannot read " << arg_analyze << endl;
+                return 1;
+            }
+        }
+        othello::analyze(arg_analyze == "-" ? cin : file, cout, settings, pool);
+        return 0;
+    }
+
     cout << othello_billboard << endl;
+    cout << "seed: " << othello::random::seed() << endl;
+    cout << "transposition table: " << settings.transpositions->allocation().describe() << endl;
+
+    if (arg_print_pv)
+        searcher->report = print_principal_variation;
 
     othello::game game;
     ofstream file;
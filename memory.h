@@ -0,0 +1,191 @@
+#ifndef OTHELLO_MEMORY_H
+#define OTHELLO_MEMORY_H
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace othello {
+
+enum page_mode {
+    small_pages,
+    transparent_huge_pages, // madvised, the kernel may still decline
+    huge_pages, // reserved in /proc/sys/vm/nr_hugepages
+};
+
+const char *to_string(page_mode m)
+{
+    switch (m) {
+    case transparent_huge_pages:
+        return "transparent huge pages";
+    case huge_pages:
+        return "huge pages";
+    default:
+        return "small pages";
+    }
+}
+
+struct memory_options {
+    // preferred mode, each falling back to the next smaller one
+    page_mode pages = transparent_huge_pages;
+    // spreads the pages over the NUMA nodes instead of the first to touch
+    bool interleave = false;
+};
+
+// Zeroed memory mapped for large tables, whose random accesses miss the
+// TLB on small pages: 2 MB pages cover 512 times more memory per entry.
+class large_memory {
+    void *address = nullptr;
+    size_t length = 0;
+    page_mode mode = small_pages;
+    unsigned nodes = 0; // interleaved over, 0 when not
+
+    static constexpr size_t huge_page = size_t(2) << 20;
+
+    static void *map(size_t n, int flags)
+    {
+        void *p = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+
+    // mbind(MPOL_INTERLEAVE) without libnuma; before the pages are touched.
+    unsigned interleave()
+    {
+#ifdef SYS_mbind
+        const int mpol_interleave = 3;
+        auto online = online_nodes();
+        unsigned long mask = 0;
+        for (unsigned n : online)
+            mask |= 1UL << n;
+        if (online.size() > 1 && syscall(SYS_mbind, address, length, mpol_interleave, &mask, 64, 0) == 0)
+            return online.size();
+#endif
+        return 0;
+    }
+
+public:
+    // Online NUMA nodes, from a list like "0-1,3".
+    static std::vector<unsigned> online_nodes()
+    {
+        std::vector<unsigned> nodes;
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string range;
+        while (std::getline(in, range, ',')) {
+            unsigned first, last;
+            int n = std::sscanf(range.c_str(), "%u-%u", &first, &last);
+            if (n == 1)
+                last = first;
+            for (unsigned i = first; n >= 1 && i <= last && i < 64; i++)
+                nodes.push_back(i);
+        }
+        return nodes;
+    }
+
+    large_memory() = default;
+
+    large_memory(size_t bytes, const memory_options &o = memory_options())
+    {
+        if (bytes >= huge_page) {
+            length = (bytes + huge_page - 1) / huge_page * huge_page;
+#ifdef MAP_HUGETLB
+            if (o.pages == huge_pages && (address = map(length, MAP_HUGETLB)))
+                mode = huge_pages;
+#endif
+#ifdef MADV_HUGEPAGE
+            if (!address && o.pages != small_pages) {
+                // over allocated to align on a huge page, then trimmed
+                char *p = static_cast<char *>(map(length + huge_page, 0));
+                if (p) {
+                    size_t skip = (huge_page - reinterpret_cast<size_t>(p) % huge_page) % huge_page;
+                    if (skip)
+                        munmap(p, skip);
+                    munmap(p + skip + length, huge_page - skip);
+                    address = p + skip;
+                    if (madvise(address, length, MADV_HUGEPAGE) == 0)
+                        mode = transparent_huge_pages;
+                }
+            }
+#endif
+        }
+        if (!address) {
+            length = bytes;
+            address = map(length, 0);
+        }
+        if (!address)
+            throw std::bad_alloc();
+        if (o.interleave)
+            nodes = interleave();
+    }
+
+    large_memory(large_memory &&o) noexcept
+        : address(std::exchange(o.address, nullptr)), length(std::exchange(o.length, 0)),
+          mode(o.mode), nodes(o.nodes)
+    {}
+
+    large_memory &operator=(large_memory &&o) noexcept
+    {
+        std::swap(address, o.address);
+        std::swap(length, o.length);
+        std::swap(mode, o.mode);
+        std::swap(nodes, o.nodes);
+        return *this;
+    }
+
+    ~large_memory()
+    {
+        if (address)
+            munmap(address, length);
+    }
+
+    void *data() const { return address; }
+    size_t size() const { return length; }
+    page_mode pages() const { return mode; }
+    unsigned interleaved_nodes() const { return nodes; }
+
+    // Bytes backed by huge pages, as /proc/self/smaps reports them.
+    size_t huge_bytes() const
+    {
+        if (mode == huge_pages)
+            return length;
+        std::ifstream smaps("/proc/self/smaps");
+        std::string line;
+        bool inside = false;
+        size_t begin = reinterpret_cast<size_t>(address), huge = 0;
+        while (std::getline(smaps, line)) {
+            size_t from, to;
+            if (std::sscanf(line.c_str(), "%zx-%zx ", &from, &to) == 2) {
+                inside = from < begin + length && to > begin;
+                continue;
+            }
+            size_t kb;
+            if (inside && std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1)
+                huge += kb << 10;
+        }
+        return huge;
+    }
+
+    // e.g. "64 MB on transparent huge pages (64 MB huge)"
+    std::string describe() const
+    {
+        std::ostringstream s;
+        s << (length >> 20) << " MB on " << to_string(mode);
+        if (mode == transparent_huge_pages)
+            s << " (" << (huge_bytes() >> 20) << " MB huge)";
+        if (nodes)
+            s << ", interleaved over " << nodes << " NUMA nodes";
+        return s.str();
+    }
+};
+
+}
+
+#endif // OTHELLO_MEMORY_H
@@ -0,0 +1,182 @@
+#ifndef OTHELLO_OPENINGS_H
+#define OTHELLO_OPENINGS_H
+
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "analyze.h"
+#include "core.h"
+#include "io.h"
+#include "pool.h"
+#include "search.h"
+
+namespace othello {
+
+// Moves played from game::init before a tournament game starts.
+using opening = std::vector<bitpos>;
+
+namespace symmetry {
+
+// Rows, index y * 8 + x, upside down.
+constexpr bitmap8x8 flip_vertical(bitmap8x8 b)
+{
+    return __builtin_bswap64(b);
+}
+
+// Columns right to left.
+constexpr bitmap8x8 mirror_horizontal(bitmap8x8 b)
+{
+    constexpr bitmap8x8 k1 = 0x5555555555555555ULL;
+    constexpr bitmap8x8 k2 = 0x3333333333333333ULL;
+    constexpr bitmap8x8 k4 = 0x0f0f0f0f0f0f0f0fULL;
+    b = ((b >> 1) & k1) | ((b & k1) << 1);
+    b = ((b >> 2) & k2) | ((b & k2) << 2);
+    b = ((b >> 4) & k4) | ((b & k4) << 4);
+    return b;
+}
+
+// Swaps x and y.
+constexpr bitmap8x8 transpose(bitmap8x8 b)
+{
+    constexpr bitmap8x8 k1 = 0x5500550055005500ULL;
+    constexpr bitmap8x8 k2 = 0x3333000033330000ULL;
+    constexpr bitmap8x8 k4 = 0x0f0f0f0f00000000ULL;
+    bitmap8x8 t = k4 & (b ^ (b << 28));
+    b ^= t ^ (t >> 28);
+    t = k2 & (b ^ (b << 14));
+    b ^= t ^ (t >> 14);
+    t = k1 & (b ^ (b << 7));
+    b ^= t ^ (t >> 7);
+    return b;
+}
+
+// The i-th of the 8 symmetries of the square, 0 is the identity.
+constexpr bitmap8x8 apply(int i, bitmap8x8 b)
+{
+    if (i & 1)
+        b = flip_vertical(b);
+    if (i & 2)
+        b = mirror_horizontal(b);
+    if (i & 4)
+        b = transpose(b);
+    return b;
+}
+
+// Same key for all the symmetric images of a position.
+std::tuple<bitmap8x8, bitmap8x8, piece_color> canonical(const game &g)
+{
+    auto key = std::make_tuple(g.bitmap<white>(), g.bitmap<black>(), g.player());
+    for (int i = 1; i < 8; i++)
+        key = std::min(key, std::make_tuple(apply(i, g.bitmap<white>()), apply(i, g.bitmap<black>()), g.player()));
+    return key;
+}
+
+}
+
+game start_position(const opening &moves)
+{
+    game g;
+    for (bitpos p : moves)
+        g.place_piece(p);
+    return g;
+}
+
+// Every position plies moves deep, one per class of symmetric positions,
+// as the first line found reaching it.
+std::vector<opening> enumerate_openings(int plies)
+{
+    std::vector<opening> found;
+    std::set<std::tuple<bitmap8x8, bitmap8x8, piece_color>> seen;
+    opening line;
+    std::function<void(const game &)> visit = [&](const game &g) {
+        if ((int)line.size() == plies) {
+            if (seen.insert(symmetry::canonical(g)).second)
+                found.push_back(line);
+            return;
+        }
+        for (bitpos p : g.possible_place_positions()) {
+            line.push_back(p);
+            visit(g.test_piece(p));
+            line.pop_back();
+        }
+    };
+    visit(game());
+    return found;
+}
+
+// Openings plies moves deep whose score, searched with s on all the pool
+// threads, is within max_score of even.
+std::vector<opening> generate_openings(int plies, const search::settings &s,
+    int max_score, thread_pool &pool)
+{
+    search::settings config = s;
+    if (!config.transpositions)
+        config.transpositions = std::make_shared<search::transposition_table>();
+    searcher_pool searchers(config);
+
+    std::vector<opening> candidates = enumerate_openings(plies);
+    std::vector<std::future<int>> scores;
+    for (const opening &o : candidates) {
+        scores.push_back(pool.submit([&o, &searchers]() {
+            game g = start_position(o);
+            if (g.is_game_over())
+                return INT_MAX;
+            auto searcher = searchers.acquire();
+            int score = searcher->search(g).score;
+            searchers.release(std::move(searcher));
+            return score;
+        }));
+    }
+
+    std::vector<opening> balanced;
+    for (unsigned i = 0; i < candidates.size(); i++) {
+        long long score = scores[i].get();
+        if (std::abs(score) <= max_score)
+            balanced.push_back(candidates[i]);
+    }
+    return balanced;
+}
+
+// Opening suites are stored as binary game records, see
+// io::write_binary_game, under their own magic: one byte per move.
+constexpr char openings_magic[8] = {'O', 'T', 'H', 'O', 'P', 'E', 'N', 'S'};
+
+void write_openings(std::ostream &out, const std::vector<opening> &suite)
+{
+    out.write(openings_magic, sizeof(openings_magic));
+    for (const opening &o : suite)
+        io::write_binary_game(out, o);
+}
+
+// False if in is not an opening suite or holds an illegal opening.
+bool read_openings(std::istream &in, std::vector<opening> &suite)
+{
+    char magic[sizeof(openings_magic)];
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), openings_magic))
+        return false;
+
+    suite.clear();
+    opening current;
+    game g;
+    int c;
+    while ((c = in.get()) != EOF) {
+        bitpos p = util::bit(c & 0x3f);
+        if ((c & 0x40) || !g.place_piece(p))
+            return false;
+        current.push_back(p);
+        if (c & io::binary_last_move) {
+            suite.push_back(current);
+            current.clear();
+            g.init();
+        }
+    }
+    return current.empty();
+}
+
+}
+
+#endif // OTHELLO_OPENINGS_H
@@ -3,10 +3,25 @@
 
 #include "types.h"
 #include "core.h"
+#include "stats.h"
+#include "rng.h"
+#include "trace.h"
 #include "play.h"
 #include "score.h"
+#include "table.h"
+#include "search.h"
+#include "ponder.h"
 #include "strategy.h"
 #include "io.h"
+#include "pool.h"
+#include "engine.h"
+#include "async.h"
+#include "server.h"
+#include "analyze.h"
+#include "solve.h"
+#include "verify.h"
+#include "openings.h"
 #include "benchmark.h"
+#include "jobs.h"
 
 #endif
@@ -0,0 +1,104 @@
+#ifndef OTHELLO_C_H
+#define OTHELLO_C_H
+
+/*
+ * C interface of libothello.so, for programs embedding the engine instead
+ * of running the othello binary. Positions are plain bitmaps, bit 8 y + x
+ * being the square of column x and row y; moves are single bit masks, 0
+ * for none.
+ *
+ * Every call taking arrays works on n positions at once, so that callers
+ * cross the library boundary once per batch rather than once per position.
+ * The functions without an engine are reentrant. An engine may be shared
+ * by threads, which then take turns; distinct engines run in parallel.
+ *
+ * The layout of othello_position and the values below only ever grow:
+ * OTHELLO_ABI_VERSION changes when they cannot.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define OTHELLO_API __attribute__((visibility("default")))
+#else
+#define OTHELLO_API
+#endif
+
+#define OTHELLO_ABI_VERSION 1
+
+enum othello_status {
+    OTHELLO_OK = 0,
+    OTHELLO_INVALID = -1, /* bad position, move or argument */
+    OTHELLO_FAILED = -2,  /* out of memory or internal error */
+};
+
+enum othello_color {
+    OTHELLO_WHITE = 1,
+    OTHELLO_BLACK = 2,
+};
+
+/* Static evaluators, white minus black. */
+enum othello_evaluator {
+    OTHELLO_PIECES_DIFF = 0,
+    OTHELLO_BORDERS_AND_CORNERS = 1,
+    OTHELLO_POSSIBLE_PLACE_POSITIONS = 2,
+    OTHELLO_STABLE_PIECES_DIFF = 3,
+    OTHELLO_MOBILITY_FRONTIER = 4,
+};
+
+enum othello_strategy {
+    OTHELLO_RANDOM = 0,
+    OTHELLO_MAXIMIZE = 1,  /* best evaluation one move ahead */
+    OTHELLO_MINMAX = 2,
+    OTHELLO_ALPHABETA = 3,
+    OTHELLO_PROBCUT = 4,   /* Multi-ProbCut, mobility frontier only */
+    OTHELLO_SEARCH = 5,    /* iterative deepening with a table */
+    OTHELLO_SOLVE = 6,     /* exact endgame solver, depth ignored */
+};
+
+typedef struct othello_position {
+    uint64_t whites;
+    uint64_t blacks;
+    int32_t player; /* othello_color to move */
+} othello_position;
+
+typedef struct othello_engine othello_engine;
+
+OTHELLO_API int othello_abi_version(void);
+
+/* Seeds the random strategies of the calling thread, which restarts its
+ * stream, and of the threads drawing their first number afterwards.
+ * Threads which already drew keep their streams. */
+OTHELLO_API void othello_seed(uint64_t seed);
+
+OTHELLO_API void othello_initial_position(othello_position *p);
+
+/* Plays move on each positions[i], moves[i] being a legal move of it. The
+ * turn passes when the next player cannot move. Stops at the first illegal
+ * move, with OTHELLO_INVALID. */
+OTHELLO_API int othello_play(othello_position *positions, const uint64_t *moves, size_t n);
+
+/* Legal moves of the player to move, 0 once the game is over. */
+OTHELLO_API int othello_moves(const othello_position *positions, size_t n, uint64_t *moves);
+
+OTHELLO_API int othello_evaluate(const othello_position *positions, size_t n, int evaluator, int32_t *scores);
+
+/* Engine playing strategy, searching depth plies with evaluator where the
+ * strategy searches. NULL on bad arguments. */
+OTHELLO_API othello_engine *othello_engine_new(int strategy, int depth, int evaluator);
+OTHELLO_API void othello_engine_free(othello_engine *e);
+
+/* Moves the engine plays in each position, 0 once the game is over. */
+OTHELLO_API int othello_best_moves(othello_engine *e, const othello_position *positions, size_t n,
+    uint64_t *moves);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTHELLO_C_H */
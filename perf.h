@@ -0,0 +1,138 @@
+#ifndef OTHELLO_PERF_H
+#define OTHELLO_PERF_H
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace othello {
+
+// Hardware counters of the calling thread, read through perf_event_open,
+// user space only so that the default perf_event_paranoid level allows
+// them. Counters the kernel, the CPU or the sandbox refuse are reported
+// as unavailable and the others keep working.
+class hardware_counters {
+public:
+    enum event { cycles, instructions, branch_misses, l1d_misses, llc_misses, events };
+
+    static constexpr const char *names[events] = {
+        "cycles", "instructions", "branch misses", "L1d misses", "LLC misses",
+    };
+
+    struct sample {
+        std::array<double, events> values{};
+        std::array<bool, events> available{};
+
+        double operator[](event e) const { return values[e]; }
+        bool has(event e) const { return available[e]; }
+    };
+
+private:
+    std::array<int, events> fds;
+    int open_error = 0; // errno of the first event which failed to open
+
+    static int open_event(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    int open_event_checked(uint32_t type, uint64_t config)
+    {
+        int fd = open_event(type, config);
+        if (fd < 0 && !open_error)
+            open_error = errno;
+        return fd;
+    }
+
+    void ioctl_all(unsigned long request)
+    {
+        for (int fd : fds)
+            if (fd >= 0)
+                ioctl(fd, request, 0);
+    }
+
+public:
+    hardware_counters()
+    {
+        constexpr uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D
+            | PERF_COUNT_HW_CACHE_OP_READ << 8
+            | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+        fds[cycles] = open_event_checked(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds[instructions] = open_event_checked(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[branch_misses] = open_event_checked(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        fds[l1d_misses] = open_event_checked(PERF_TYPE_HW_CACHE, l1d_read_miss);
+        fds[llc_misses] = open_event_checked(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    }
+
+    ~hardware_counters()
+    {
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    hardware_counters(const hardware_counters &) = delete;
+    hardware_counters &operator=(const hardware_counters &) = delete;
+
+    // Why some counters are unavailable, empty when all of them are.
+    std::string error() const
+    {
+        return open_error ? std::strerror(open_error) : "";
+    }
+
+    bool any() const
+    {
+        for (int fd : fds)
+            if (fd >= 0)
+                return true;
+        return false;
+    }
+
+    void start()
+    {
+        ioctl_all(PERF_EVENT_IOC_RESET);
+        ioctl_all(PERF_EVENT_IOC_ENABLE);
+    }
+
+    // Counts since start, scaled up when the kernel multiplexed a counter.
+    sample stop()
+    {
+        ioctl_all(PERF_EVENT_IOC_DISABLE);
+        sample s;
+        for (int e = 0; e < events; e++) {
+            uint64_t data[3]; // value, time enabled, time running
+            if (fds[e] < 0 || read(fds[e], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+                continue;
+            s.values[e] = double(data[0]) * data[1] / data[2];
+            s.available[e] = true;
+        }
+        return s;
+    }
+
+    template<typename F>
+    sample measure(F f)
+    {
+        start();
+        f();
+        return stop();
+    }
+};
+
+}
+
+#endif // OTHELLO_PERF_H
@@ -2,6 +2,8 @@
 #define OTHELO_PLAY_H
 
 #include "core.h"
+#include "stats.h"
+#include "trace.h"
 
 #include <vector>
 
@@ -9,14 +11,19 @@ namespace othello {
 
 using strategy = std::function<bitpos(const game &, piece_color, positions)>;
 
-bitpos play_player(strategy strat, piece_color player, game &g) {
+bitpos play_player(strategy strat, piece_color player, game &g,
+    std::vector<search::statistics> *stats=nullptr) {
     assert(g.player() == player);
     
     auto possible_positions = g.possible_place_positions();
     assert(possible_positions.size() != 0);
 
+    trace::scope traced("move", "play", g.count<any>() - 3);
+    search::collect collected;
     bitpos p = strat(g, player, possible_positions);
     g.place_piece(p);
+    if (stats)
+        stats->push_back(collected.get());
 
     return p;
 }
@@ -25,17 +32,19 @@ piece_color play(game &game,
     strategy strategy_black,
     strategy strategy_white,
     std::function<void(const othello::game&, const othello::pos&)> showgame=nullptr,
-    std::function<void(const pos&)> logpos=nullptr)
+    std::function<void(const pos&)> logpos=nullptr,
+    std::vector<search::statistics> *stats=nullptr) // of the searches of each move
 {
+    trace::scope traced("game", "play");
     pos p = {-1, -1};
     while (!game.is_game_over()) {
         if (showgame) showgame(game, p);
         switch (game.player()) {
         case othello::black:
-            p = pos::from_bitpos(play_player(strategy_black, black, game));
+            p = pos::from_bitpos(play_player(strategy_black, black, game, stats));
             break;
         case othello::white:
-            p = pos::from_bitpos(play_player(strategy_white, white, game));
+            p = pos::from_bitpos(play_player(strategy_white, white, game, stats));
             break;
         default:
             break; // ignore
@@ -0,0 +1,107 @@
+#ifndef OTHELLO_PONDER_H
+#define OTHELLO_PONDER_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "search.h"
+
+namespace othello::search {
+
+// Searches on the opponent's time. While the opponent thinks about the
+// position given to start, a background thread searches the position
+// after each of its replies, the expected one first. It has its own
+// searcher and game copies, only the transposition table is shared with
+// the engine. Finished searches are kept until the real reply arrives.
+class ponderer {
+    searcher worker_searcher;
+    std::thread worker;
+    std::atomic<bool> stop_flag{false};
+    std::mutex results_mutex;
+    std::vector<std::pair<game, result>> results;
+
+    void ponder(const game &g, bitpos reply)
+    {
+        game next = g.test_piece(reply);
+        if (next.is_game_over() || next.player() == g.player())
+            return; // not our move after this reply
+
+        result r = worker_searcher.search(next, next.possible_place_positions(), {.stop = &stop_flag});
+        if (stop_flag.load())
+            return; // incomplete
+
+        std::lock_guard<std::mutex> lock(results_mutex);
+        results.emplace_back(next, r);
+    }
+
+    void run(game g, line expected)
+    {
+        // the rest of the expected line seeds the expected reply
+        worker_searcher.remember(g, {0, 0, expected.to_vector()});
+
+        positions replies = g.possible_place_positions();
+        bitpos first = expected.length ? expected.moves[0] & replies.bitmap : 0;
+        if (first)
+            ponder(g, first);
+        for (bitpos p : replies) {
+            if (stop_flag.load())
+                break;
+            if (p != first)
+                ponder(g, p);
+        }
+    }
+
+public:
+    explicit ponderer(const settings &s)
+        : worker_searcher(s)
+    {}
+
+    ~ponderer()
+    {
+        stop();
+    }
+
+    // g is the position with the opponent to move, expected the line the
+    // engine expects from it.
+    void start(const game &g, const line &expected = line())
+    {
+        stop();
+        results.clear();
+        stop_flag = false;
+        worker = std::thread(&ponderer::run, this, g, expected);
+    }
+
+    // Cancels the running search, if any, and waits for the thread.
+    void stop()
+    {
+        stop_flag = true;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // Waits for the thread to search every reply, or to be stopped.
+    void wait()
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+
+    bool find(const game &g, result &r)
+    {
+        std::lock_guard<std::mutex> lock(results_mutex);
+        for (const auto &pondered : results) {
+            if (pondered.first == g) {
+                r = pondered.second;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+}
+
+#endif // OTHELLO_PONDER_H
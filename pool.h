@@ -0,0 +1,103 @@
+#ifndef OTHELLO_POOL_H
+#define OTHELLO_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace.h"
+
+namespace othello {
+
+// Fixed set of worker threads running the submitted tasks in order.
+class thread_pool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::condition_variable idle;
+    unsigned busy = 0;
+    bool quitting = false;
+
+    void work()
+    {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_ready.wait(lock, [this] { return quitting || !tasks.empty(); });
+                if (tasks.empty())
+                    return; // quitting
+                task = std::move(tasks.front());
+                tasks.pop_front();
+                busy++;
+            }
+            {
+                trace::scope traced("task", "pool");
+                task();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+                if (busy == 0 && tasks.empty())
+                    idle.notify_all();
+            }
+        }
+    }
+
+public:
+    static unsigned default_size()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    explicit thread_pool(unsigned n = default_size())
+    {
+        for (unsigned i = 0; i < n; i++)
+            workers.emplace_back(&thread_pool::work, this);
+    }
+
+    // Runs the pending tasks, then joins the workers.
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quitting = true;
+        }
+        task_ready.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    unsigned size() const { return workers.size(); }
+
+    template<typename F>
+    auto submit(F f) -> std::future<decltype(f())>
+    {
+        auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+        auto result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([task] { (*task)(); });
+        }
+        task_ready.notify_one();
+        return result;
+    }
+
+    // Blocks until every submitted task has run.
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return busy == 0 && tasks.empty(); });
+    }
+};
+
+}
+
+#endif // OTHELLO_POOL_H
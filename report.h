@@ -0,0 +1,344 @@
+#ifndef OTHELLO_REPORT_H
+#define OTHELLO_REPORT_H
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace othello::report {
+
+// Results of a benchmark run, written as JSON or CSV and compared by
+// ./benchmark compare.
+struct latency {
+    double mean = 0, stddev = 0, p50 = 0, p90 = 0, p99 = 0, max = 0; // us
+
+    static latency of(std::vector<float> samples)
+    {
+        latency l;
+        if (samples.empty())
+            return l;
+        std::sort(samples.begin(), samples.end());
+        double sum = 0, sum2 = 0;
+        for (float s : samples) {
+            sum += s;
+            sum2 += double(s) * s;
+        }
+        double n = samples.size();
+        l.mean = sum / n;
+        l.stddev = std::sqrt(std::max(0.0, sum2 / n - l.mean * l.mean));
+        auto at = [&](double q) { return samples[std::min<size_t>(samples.size() - 1, q * samples.size())]; };
+        l.p50 = at(0.50);
+        l.p90 = at(0.90);
+        l.p99 = at(0.99);
+        l.max = samples.back();
+        return l;
+    }
+};
+
+struct strategy_result {
+    std::string name;
+    double games = 0;
+    double moves = 0;
+    double nodes = 0;
+    double nodes_per_s = 0;
+    latency move_latency;
+    double score = 0; // share of the points won
+    double score_low = 0, score_high = 0; // 95% confidence interval
+};
+
+struct run {
+    std::vector<std::pair<std::string, std::string>> metadata;
+    double elapsed_s = 0;
+    double games = 0;
+    double games_per_s = 0;
+    double nodes = 0;
+    double nodes_per_s = 0;
+    std::vector<strategy_result> strategies;
+};
+
+// Version, host, kernel, compiler and date of the run.
+std::vector<std::pair<std::string, std::string>> host_metadata(const std::string &version)
+{
+    std::vector<std::pair<std::string, std::string>> m = {{"version", version}};
+    utsname u;
+    if (uname(&u) == 0) {
+        m.push_back({"host", u.nodename});
+        m.push_back({"kernel", std::string(u.sysname) + " " + u.release});
+        m.push_back({"machine", u.machine});
+    }
+    m.push_back({"compiler", __VERSION__});
+    m.push_back({"threads", std::to_string(std::thread::hardware_concurrency())});
+    char date[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    m.push_back({"date", date});
+    return m;
+}
+
+std::string quoted(const std::string &s)
+{
+    std::string q = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            q += '\\';
+        if (c == '\n')
+            q += "\\n";
+        else
+            q += c;
+    }
+    return q + "\"";
+}
+
+void write_json(std::ostream &out, const run &r)
+{
+    out << std::setprecision(10) << "{\n  \"metadata\": {";
+    for (unsigned i = 0; i < r.metadata.size(); i++)
+        out << (i ? ", " : "") << quoted(r.metadata[i].first) << ": " << quoted(r.metadata[i].second);
+    out << "},\n"
+        << "  \"elapsed_s\": " << r.elapsed_s << ",\n"
+        << "  \"games\": " << r.games << ",\n"
+        << "  \"games_per_s\": " << r.games_per_s << ",\n"
+        << "  \"nodes\": " << r.nodes << ",\n"
+        << "  \"nodes_per_s\": " << r.nodes_per_s << ",\n"
+        << "  \"strategies\": [";
+    for (unsigned i = 0; i < r.strategies.size(); i++) {
+        const strategy_result &s = r.strategies[i];
+        const latency &l = s.move_latency;
+        out << (i ? "," : "") << "\n    {\"name\": " << quoted(s.name)
+            << ", \"games\": " << s.games << ", \"moves\": " << s.moves
+            << ", \"nodes\": " << s.nodes << ", \"nodes_per_s\": " << s.nodes_per_s
+            << ", \"latency_us\": {\"mean\": " << l.mean << ", \"stddev\": " << l.stddev
+            << ", \"p50\": " << l.p50 << ", \"p90\": " << l.p90 << ", \"p99\": " << l.p99
+            << ", \"max\": " << l.max << "}"
+            << ", \"score\": " << s.score << ", \"score_low\": " << s.score_low
+            << ", \"score_high\": " << s.score_high << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// One line per strategy, the run metadata and totals as # comments.
+void write_csv(std::ostream &out, const run &r)
+{
+    out << std::setprecision(10);
+    for (auto &m : r.metadata)
+        out << "# " << m.first << "=" << m.second << "\n";
+    out << "# elapsed_s=" << r.elapsed_s << "\n# games_per_s=" << r.games_per_s
+        << "\n# nodes_per_s=" << r.nodes_per_s << "\n";
+    out << "name,games,moves,nodes,nodes_per_s,mean_us,stddev_us,p50_us,p90_us,p99_us,max_us,score,score_low,score_high\n";
+    for (auto &s : r.strategies) {
+        const latency &l = s.move_latency;
+        out << quoted(s.name) << "," << s.games << "," << s.moves << "," << s.nodes << "," << s.nodes_per_s
+            << "," << l.mean << "," << l.stddev << "," << l.p50 << "," << l.p90 << "," << l.p99 << "," << l.max
+            << "," << s.score << "," << s.score_low << "," << s.score_high << "\n";
+    }
+}
+
+// Just enough JSON to read back write_json files.
+struct json {
+    enum kind { null, number, string, array, object } type = null;
+    double value = 0;
+    std::string text;
+    std::vector<json> items;
+    std::vector<std::pair<std::string, json>> fields;
+
+    const json &operator[](const std::string &key) const
+    {
+        static const json missing;
+        for (auto &f : fields)
+            if (f.first == key)
+                return f.second;
+        return missing;
+    }
+
+    double num() const { return value; }
+};
+
+class json_parser {
+    std::string_view in;
+    size_t at = 0;
+
+    void blanks()
+    {
+        while (at < in.size() && std::isspace((unsigned char)in[at]))
+            at++;
+    }
+
+    bool eat(char c)
+    {
+        blanks();
+        if (at < in.size() && in[at] == c) {
+            at++;
+            return true;
+        }
+        return false;
+    }
+
+    bool parse_string(std::string &s)
+    {
+        if (!eat('"'))
+            return false;
+        for (; at < in.size() && in[at] != '"'; at++) {
+            if (in[at] == '\\' && ++at < in.size())
+                s += in[at] == 'n' ? '\n' : in[at];
+            else
+                s += in[at];
+        }
+        return eat('"');
+    }
+
+public:
+    explicit json_parser(std::string_view s)
+        : in(s)
+    {}
+
+    bool parse(json &v)
+    {
+        blanks();
+        if (at >= in.size())
+            return false;
+        if (in[at] == '{') {
+            at++;
+            v.type = json::object;
+            if (eat('}'))
+                return true;
+            do {
+                std::pair<std::string, json> f;
+                if (!parse_string(f.first) || !eat(':') || !parse(f.second))
+                    return false;
+                v.fields.push_back(std::move(f));
+            } while (eat(','));
+            return eat('}');
+        }
+        if (in[at] == '[') {
+            at++;
+            v.type = json::array;
+            if (eat(']'))
+                return true;
+            do {
+                v.items.emplace_back();
+                if (!parse(v.items.back()))
+                    return false;
+            } while (eat(','));
+            return eat(']');
+        }
+        if (in[at] == '"') {
+            v.type = json::string;
+            return parse_string(v.text);
+        }
+        if (in.substr(at, 4) == "null") {
+            at += 4;
+            return true;
+        }
+        char *end;
+        std::string rest(in.substr(at, 32));
+        v.value = std::strtod(rest.c_str(), &end);
+        if (end == rest.c_str())
+            return false;
+        v.type = json::number;
+        at += end - rest.c_str();
+        return true;
+    }
+};
+
+bool read_json(std::istream &in, run &r)
+{
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+    json root;
+    if (!json_parser(text).parse(root) || root.type != json::object)
+        return false;
+
+    for (auto &f : root["metadata"].fields)
+        r.metadata.push_back({f.first, f.second.text});
+    r.elapsed_s = root["elapsed_s"].num();
+    r.games = root["games"].num();
+    r.games_per_s = root["games_per_s"].num();
+    r.nodes = root["nodes"].num();
+    r.nodes_per_s = root["nodes_per_s"].num();
+    for (const json &s : root["strategies"].items) {
+        strategy_result sr;
+        sr.name = s["name"].text;
+        sr.games = s["games"].num();
+        sr.moves = s["moves"].num();
+        sr.nodes = s["nodes"].num();
+        sr.nodes_per_s = s["nodes_per_s"].num();
+        const json &l = s["latency_us"];
+        sr.move_latency = {l["mean"].num(), l["stddev"].num(), l["p50"].num(),
+            l["p90"].num(), l["p99"].num(), l["max"].num()};
+        sr.score = s["score"].num();
+        sr.score_low = s["score_low"].num();
+        sr.score_high = s["score_high"].num();
+        r.strategies.push_back(sr);
+    }
+    return true;
+}
+
+struct regression {
+    std::string strategy;
+    std::string what; // "latency", "strength", "games/s" or "nodes/s"
+    double base, current;
+    double z; // 0 for throughput, one timed run giving no variance
+};
+
+// Strategies of current significantly slower or weaker than in base: the
+// mean move latency by Welch's test when it grew by more than
+// min_slowdown, the score by a two proportions test. z is the number of
+// standard errors of the difference. The games/s of the run and the
+// nodes/s of the run and of each strategy come from a single timing each,
+// so they are only flagged past a plain threshold, max_throughput_drop,
+// to be set above the run to run noise of the machine; nodes/s is not
+// compared when either side counted no node.
+std::vector<regression> compare(const run &base, const run &current,
+    double z_threshold = 3, double min_slowdown = 0.05, double max_throughput_drop = 0.10)
+{
+    std::vector<regression> found;
+    auto throughput = [&](const std::string &strategy, const char *what,
+        double count_b, double rate_b, double count_c, double rate_c) {
+        if (count_b > 0 && count_c > 0 && rate_c < rate_b * (1 - max_throughput_drop))
+            found.push_back({strategy, what, rate_b, rate_c, 0});
+    };
+    throughput("all", "games/s", base.games, base.games_per_s, current.games, current.games_per_s);
+    throughput("all", "nodes/s", base.nodes, base.nodes_per_s, current.nodes, current.nodes_per_s);
+
+    for (const strategy_result &c : current.strategies) {
+        auto b = std::find_if(base.strategies.begin(), base.strategies.end(),
+            [&](const strategy_result &s) { return s.name == c.name; });
+        if (b == base.strategies.end())
+            continue;
+
+        const latency &lb = b->move_latency, &lc = c.move_latency;
+        double se = std::sqrt(lb.stddev * lb.stddev / std::max(1.0, b->moves)
+            + lc.stddev * lc.stddev / std::max(1.0, c.moves));
+        double z = se > 0 ? (lc.mean - lb.mean) / se : 0;
+        if (z > z_threshold && lc.mean > lb.mean * (1 + min_slowdown))
+            found.push_back({c.name, "latency", lb.mean, lc.mean, z});
+
+        double sb = (b->score_high - b->score_low) / (2 * 1.96);
+        double sc = (c.score_high - c.score_low) / (2 * 1.96);
+        se = std::sqrt(sb * sb + sc * sc);
+        z = se > 0 ? (c.score - b->score) / se : 0;
+        if (z < -z_threshold)
+            found.push_back({c.name, "strength", b->score, c.score, -z});
+
+        throughput(c.name, "nodes/s", b->nodes, b->nodes_per_s, c.nodes, c.nodes_per_s);
+    }
+    return found;
+}
+
+}
+
+#endif // OTHELLO_REPORT_H
@@ -0,0 +1,103 @@
+#ifndef OTHELLO_RNG_H
+#define OTHELLO_RNG_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace othello {
+
+// Small, fast generator (splitmix64) whose whole state is one word, so
+// that streams are cheap to derive, save and restore.
+class rng {
+    uint64_t state;
+
+public:
+    explicit constexpr rng(uint64_t seed = 0)
+        : state(seed)
+    {}
+
+    constexpr uint64_t next()
+    {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [0, n).
+    constexpr unsigned below(unsigned n)
+    {
+        return ((next() >> 32) * n) >> 32;
+    }
+};
+
+// Every random choice goes through the generator of the calling thread.
+// Its stream is derived from the run seed and from the id given to
+// random::stream, a game number for instance, so a run gives the same
+// games whichever thread plays them and in whichever order.
+namespace random {
+
+std::atomic<uint64_t> &run_seed()
+{
+    static std::atomic<uint64_t> s{1};
+    return s;
+}
+
+constexpr uint64_t derive(uint64_t seed, uint64_t id)
+{
+    rng r(seed ^ (id * 0xd1b54a32d192ed03ULL));
+    r.next();
+    return r.next();
+}
+
+// Threads which never select a stream get one of their own, in the order
+// they first draw a number.
+rng &local()
+{
+    static std::atomic<uint64_t> threads{0};
+    thread_local rng r(derive(run_seed(), ~threads.fetch_add(1)));
+    return r;
+}
+
+uint64_t seed()
+{
+    return run_seed();
+}
+
+// Seeds the run. The calling thread restarts on its default stream.
+void seed(uint64_t s)
+{
+    run_seed() = s;
+    local() = rng(derive(s, ~0ULL));
+}
+
+unsigned below(unsigned n)
+{
+    return local().below(n);
+}
+
+// Draws the numbers of the calling thread from stream id while it lives.
+class stream {
+    rng saved;
+
+public:
+    explicit stream(uint64_t id)
+        : saved(local())
+    {
+        local() = rng(derive(seed(), id));
+    }
+
+    ~stream()
+    {
+        local() = saved;
+    }
+
+    stream(const stream &) = delete;
+    stream &operator=(const stream &) = delete;
+};
+
+}
+
+}
+
+#endif // OTHELLO_RNG_H
@@ -1,11 +1,15 @@
 #ifndef OTHELLO_SCORE_FUNC_H
 #define OTHELLO_SCORE_FUNC_H
 
+#include <algorithm>
 #include <climits>
 #include <functional>
+#include <utility>
 #include <string>
 
 #include "core.h"
+#include "linear.h"
+#include "stats.h"
 
 namespace othello::score {
 
@@ -23,57 +27,241 @@ int terminal(const game &g)
     return 0;
 }
 
-int pieces_diff_with_borders_and_corners_(const game &g, int corner_score = 6, int border_score = 2)
+// Bounds of the final white - black disc difference, given that stable
+// discs will keep their color until the end of the game.
+template<typename position>
+void final_diff_bounds(const position &g, int &lower, int &upper)
 {
-    return
-        + g.count<white>(mask::inner)
-        + g.count<white>(mask::border) * border_score
-        + g.count<white>(mask::corners) * corner_score
-        - g.count<black>(mask::inner)
-        - g.count<black>(mask::border) * border_score
-        - g.count<black>(mask::corners) * corner_score;
+    lower = 2 * popcount(g.template stable<white>()) - 64;
+    upper = 64 - 2 * popcount(g.template stable<black>());
 }
 
-int possible_place_positions_(const game &g, int corner_score = 6)
+// Once a player owns more than half of the board in stable discs the game
+// is decided: returns the terminal score of the winner, or 0 if undecided.
+template<typename position>
+int decided_by_stability(const position &g)
 {
-    int cur_player_score =
-        + ((g.player() == white)
-            ? popcount(g.possible_place_positions().bitmap)
-            : -popcount(g.possible_place_positions().bitmap))
-        + g.count<white>(mask::corners) * corner_score
-        - g.count<black>(mask::corners) * corner_score;
-
-    return cur_player_score;
+    // cheap test first, a majority of stable discs requires a majority
+    if (g.template count<white>() <= 32 && g.template count<black>() <= 32)
+        return 0;
+
+    int lower, upper;
+    final_diff_bounds(g, lower, upper);
+    if (lower > 0)
+        return INT_MAX;
+    if (upper < 0)
+        return INT_MIN;
+    return 0;
 }
 
+// The evaluators, as weighted sums of features. They apply to a game or
+// to a leaf of a batch.
+typedef linear<term<1, discs<mask::all>>> pieces_diff_terms;
+
+typedef linear<
+    term<1, discs<mask::inner>>,
+    term<2, discs<mask::border>>,
+    term<6, discs<mask::corners>>> borders_and_corners_terms;
+
+typedef linear<
+    term<1, player_mobility>,
+    term<6, discs<mask::corners>>> possible_place_positions_terms;
+
+typedef linear<
+    term<1, discs<mask::inner>>,
+    term<2, discs<mask::border>>,
+    term<6, discs<mask::corners>>,
+    term<4, stability>> stable_pieces_diff_terms;
+
+// Mobility of both players, potential mobility and frontier discs, all
+// computed on whole bitmaps instead of square by square.
+typedef linear<
+    term<4, mobility>,
+    term<1, potential_mobility>,
+    term<-1, frontier>,
+    term<32, discs<mask::corners>>> mobility_frontier_terms;
+
 int pieces_diff_score(const game &g)
 {
-    return g.count<white>() - g.count<black>();
+    return pieces_diff_terms::eval(g);
 }
 
 int pieces_diff_with_borders_and_corners(const game &g)
 {
-    return pieces_diff_with_borders_and_corners_(g, 6, 2);
+    return borders_and_corners_terms::eval(g);
 }
 
 int possible_place_positions(const game &g)
 {
-    return possible_place_positions_(g, 6);
+    return possible_place_positions_terms::eval(g);
+}
+
+int stable_pieces_diff(const game &g)
+{
+    return stable_pieces_diff_terms::eval(g);
 }
 
-int minmax_score_game_state(const game &g, int depth, const score::function score)
+int mobility_frontier(const game &g)
 {
-    if (g.is_game_over())
+    return mobility_frontier_terms::eval(g);
+}
+
+// Children of a node stored as one array per field. Their moves are
+// generated in one pass over the whole batch, then shared by the end of
+// game test and by the evaluator, which scores the batch in one call
+// instead of one std::function call per child.
+struct batch {
+    static constexpr int capacity = 64;
+    bitmap8x8 whites[capacity];
+    bitmap8x8 blacks[capacity];
+    bitmap8x8 white_moves[capacity];
+    bitmap8x8 black_moves[capacity];
+    bool white_to_move[capacity];
+    int size = 0;
+
+    void push(const game &g)
+    {
+        whites[size] = g.bitmap<white>();
+        blacks[size] = g.bitmap<black>();
+        white_to_move[size] = g.player() == white;
+        size++;
+    }
+
+    void generate_moves()
+    {
+        for (int i = 0; i < size; i++) {
+            board8x8 b(whites[i], blacks[i]);
+            white_moves[i] = b.moves<white>();
+            black_moves[i] = b.moves<black>();
+        }
+    }
+};
+
+// Position i of a batch, seen as a board whose moves are known.
+struct leaf {
+    board8x8 board;
+    bitmap8x8 white_moves, black_moves;
+    bool white_to_move;
+
+    leaf(const batch &b, int i)
+        : board(b.whites[i], b.blacks[i]), white_moves(b.white_moves[i]),
+          black_moves(b.black_moves[i]), white_to_move(b.white_to_move[i])
+    {}
+
+    piece_color player() const { return white_to_move ? white : black; }
+
+    template<piece_color color>
+    int count(bitmap8x8 mask=mask::all) const { return board.count<color>(mask); }
+
+    template<piece_color color>
+    bitmap8x8 bitmap() const { return board.bitmap<color>(); }
+
+    template<piece_color color>
+    bitmap8x8 moves() const { return color == white ? white_moves : black_moves; }
+
+    template<piece_color color>
+    bitmap8x8 stable() const { return board.stable<color>(); }
+};
+
+typedef void (*batch_function)(const batch &, int *scores);
+
+// One call per batch, its positions scored one after the other.
+template<typename evaluator>
+void evaluate_batch(const batch &b, int *scores)
+{
+    for (int i = 0; i < b.size; i++)
+        scores[i] = evaluator::eval(leaf(b, i));
+}
+
+// Batch version of the evaluator f, null when it has none: lambdas and
+// evaluators with other weights are called one position at a time.
+batch_function batched(const function &f)
+{
+    typedef int (*scalar)(const game &);
+    const scalar *target = f.target<scalar>();
+    if (!target)
+        return nullptr;
+    static const std::pair<scalar, batch_function> known[] = {
+        {mobility_frontier, evaluate_batch<mobility_frontier_terms>},
+        {pieces_diff_score, evaluate_batch<pieces_diff_terms>},
+        {pieces_diff_with_borders_and_corners, evaluate_batch<borders_and_corners_terms>},
+        {stable_pieces_diff, evaluate_batch<stable_pieces_diff_terms>},
+        {possible_place_positions, evaluate_batch<possible_place_positions_terms>},
+    };
+    for (auto &k : known)
+        if (k.first == *target)
+            return k.second;
+    return nullptr;
+}
+
+// Scores of the children of g after moves, g being one ply above the
+// leaves, in move order and the same as the evaluator called child by
+// child would give. Returns the number of children; bit i of endgame is
+// set when child i was over or decided by stability.
+int score_children(const game &g, positions moves, batch_function evaluate, int *scores, uint64 &endgame)
+{
+    batch children;
+    for (bitpos p : moves)
+        children.push(g.test_piece(p));
+    children.generate_moves();
+    evaluate(children, scores);
+
+    endgame = 0;
+    for (int i = 0; i < children.size; i++) {
+        leaf l(children, i);
+        int decided;
+        if ((l.white_moves | l.black_moves) == 0) {
+            int diff = l.count<white>() - l.count<black>();
+            decided = diff > 0 ? INT_MAX : diff < 0 ? INT_MIN : 0;
+        } else if (!(decided = decided_by_stability(l))) {
+            continue;
+        }
+        scores[i] = decided;
+        endgame |= uint64(1) << i;
+    }
+    return children.size;
+}
+
+// ply is the distance from the root, for the statistics.
+int minmax_score_game_state(const game &g, int depth, const score::function score, int ply = 0)
+{
+    search::statistics &stats = search::counters();
+    stats.node(ply);
+    if (g.is_game_over()) {
+        stats.leaves++;
+        stats.endgame++;
         return othello::score::terminal(g);
+    }
 
-    if (depth <= 0)
+    if (int decided = decided_by_stability(g)) {
+        stats.leaves++;
+        stats.endgame++;
+        return decided;
+    }
+
+    if (depth <= 0) {
+        stats.leaves++;
         return score(g);
+    }
 
     bool maximize = g.player() == white;
     int final_score = maximize ? INT_MIN : INT_MAX;
+    if (batch_function evaluate = (depth == 1) ? batched(score) : nullptr) {
+        int scores[batch::capacity];
+        uint64 endgame;
+        int n = score_children(g, g.possible_place_positions(), evaluate, scores, endgame);
+        for (int i = 0; i < n; i++) {
+            stats.node(ply + 1);
+            final_score = maximize ? std::max(final_score, scores[i]) : std::min(final_score, scores[i]);
+        }
+        stats.leaves += n;
+        stats.endgame += popcount(endgame);
+        return final_score;
+    }
+
     auto possible_places = g.possible_place_positions();
     for (bitpos p : possible_places) {
-        int current_score = minmax_score_game_state(g.test_piece(p), depth - 1, score);
+        int current_score = minmax_score_game_state(g.test_piece(p), depth - 1, score, ply + 1);
         if (maximize)
             final_score = std::max(final_score, current_score);
         else
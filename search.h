@@ -0,0 +1,579 @@
+#ifndef OTHELLO_SEARCH_H
+#define OTHELLO_SEARCH_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "core.h"
+#include "score.h"
+#include "stats.h"
+#include "table.h"
+#include "trace.h"
+
+namespace othello::search {
+
+// alphabeta one ply above the leaves, with the same result and
+// statistics. Each child is scored by evaluate as a batch of one, whose
+// moves serve both the end of game test and the evaluator, which saves
+// the std::function call but batches nothing: wider batches of siblings
+// were measured slower here, as they score children that a cutoff would
+// have skipped. Only minmax scores whole sibling batches.
+int alphabeta_preleaf(const game &g, int alpha, int beta, score::batch_function evaluate, int ply)
+{
+    statistics &stats = counters();
+    bool maximize = g.player() == white;
+    int best = maximize ? INT_MIN : INT_MAX;
+    bool first = true;
+    for (bitpos p : g.possible_place_positions()) {
+        int current;
+        uint64 endgame;
+        score::score_children(g, {p}, evaluate, &current, endgame);
+        stats.node(ply + 1);
+        stats.leaves++;
+        stats.endgame += popcount(endgame);
+        if (maximize) {
+            best = std::max(best, current);
+            alpha = std::max(alpha, best);
+        } else {
+            best = std::min(best, current);
+            beta = std::min(beta, best);
+        }
+        if (alpha >= beta) {
+            stats.cutoff(first);
+            break;
+        }
+        first = false;
+    }
+    return best;
+}
+
+// Same scores as score::minmax_score_game_state, but skipping the moves
+// that cannot change the result inside the (alpha, beta) window. Fail soft:
+// a result <= alpha is an upper bound and a result >= beta a lower bound.
+// ply is the distance from the root, for the statistics.
+int alphabeta(const game &g, int depth, int alpha, int beta, const score::function &score, int ply = 0)
+{
+    statistics &stats = counters();
+    stats.node(ply);
+    if (g.is_game_over()) {
+        stats.leaves++;
+        stats.endgame++;
+        return score::terminal(g);
+    }
+
+    if (int decided = score::decided_by_stability(g)) {
+        stats.leaves++;
+        stats.endgame++;
+        return decided;
+    }
+
+    if (depth <= 0) {
+        stats.leaves++;
+        return score(g);
+    }
+
+    if (depth == 1)
+        if (score::batch_function evaluate = score::batched(score))
+            return alphabeta_preleaf(g, alpha, beta, evaluate, ply);
+
+    bool maximize = g.player() == white;
+    int best = maximize ? INT_MIN : INT_MAX;
+    bool first = true;
+    for (bitpos p : g.possible_place_positions()) {
+        int current = alphabeta(g.test_piece(p), depth - 1, alpha, beta, score, ply + 1);
+        if (maximize) {
+            best = std::max(best, current);
+            alpha = std::max(alpha, best);
+        } else {
+            best = std::min(best, current);
+            beta = std::min(beta, best);
+        }
+        if (alpha >= beta) {
+            stats.cutoff(first);
+            break;
+        }
+        first = false;
+    }
+    return best;
+}
+
+// Multi-ProbCut: the score of a deep search is predicted from a shallow
+// one as deep = a * shallow + b, with a normally distributed error of
+// deviation sigma, both scores seen by the player to move. Moves whose predicted score falls outside the window
+// with enough confidence are cut without the deep search. Each deep depth
+// has up to two checks with shallow searches of the same parity, and the
+// regression is fitted per game phase.
+struct probcut_check {
+    int shallow_depth;
+    double a, b, sigma;
+};
+
+constexpr int probcut_phases = 4;
+constexpr int probcut_min_depth = 3;
+constexpr int probcut_max_depth = 8;
+constexpr int probcut_checks = 2;
+
+constexpr int probcut_shallow_depth(int depth, int check)
+{
+    int shallow = (check == 0 ? 2 : 4) - depth % 2;
+    return shallow <= depth - 2 ? shallow : 0;
+}
+
+constexpr int probcut_phase(int discs)
+{
+    return std::min(probcut_phases - 1, (discs - 4) / 15);
+}
+
+typedef std::array<std::array<std::array<probcut_check, probcut_checks>,
+    probcut_max_depth - probcut_min_depth + 1>, probcut_phases> probcut_table;
+
+// Fitted with `./benchmark fit-probcut 200` for score::mobility_frontier.
+constexpr probcut_table probcut_mobility_frontier = {{
+    {{ // phase 0, 200 positions
+        {{{1, 0.869, 2.784, 7.510}, {0, 0.000, 0.000, 0.000}}},
+        {{{2, 0.903, 0.156, 6.646}, {0, 0.000, 0.000, 0.000}}},
+        {{{1, 0.862, 1.803, 8.707}, {3, 0.981, -0.866, 5.186}}},
+        {{{2, 0.918, 0.455, 7.764}, {4, 1.007, 0.332, 4.521}}},
+        {{{1, 0.860, 1.190, 10.090}, {3, 0.998, -1.637, 6.434}}},
+        {{{2, 0.920, 0.332, 8.530}, {4, 1.006, 0.220, 5.873}}},
+    }},
+    {{ // phase 1, 200 positions
+        {{{1, 1.032, 0.433, 9.466}, {0, 0.000, 0.000, 0.000}}},
+        {{{2, 1.019, 1.282, 7.452}, {0, 0.000, 0.000, 0.000}}},
+        {{{1, 1.043, 0.895, 12.253}, {3, 1.015, 0.422, 6.184}}},
+        {{{2, 1.027, 2.310, 10.311}, {4, 1.011, 0.988, 5.860}}},
+        {{{1, 1.048, 1.102, 14.749}, {3, 1.022, 0.610, 9.755}}},
+        {{{2, 1.043, 2.453, 13.045}, {4, 1.030, 1.087, 9.135}}},
+    }},
+    {{ // phase 2, 190 positions
+        {{{1, 1.003, 0.717, 9.469}, {0, 0.000, 0.000, 0.000}}},
+        {{{2, 1.007, 1.523, 8.701}, {0, 0.000, 0.000, 0.000}}},
+        {{{1, 1.028, 2.427, 13.543}, {3, 1.028, 1.676, 8.055}}},
+        {{{2, 1.051, 2.139, 12.588}, {4, 1.046, 0.524, 7.643}}},
+        {{{1, 1.056, 2.980, 16.365}, {3, 1.058, 2.193, 11.009}}},
+        {{{2, 1.084, 2.001, 15.616}, {4, 1.082, 0.303, 10.621}}},
+    }},
+    {{ // phase 3, 50 positions
+        {{{1, 0.913, 0.259, 15.322}, {0, 0.000, 0.000, 0.000}}},
+        {{{2, 1.016, 1.050, 9.623}, {0, 0.000, 0.000, 0.000}}},
+        {{{1, 0.970, 0.881, 19.386}, {3, 1.065, 0.601, 10.083}}},
+        {{{2, 1.094, 0.368, 15.448}, {4, 1.073, -0.741, 12.285}}},
+        {{{1, 1.011, 1.831, 23.716}, {3, 1.112, 1.530, 15.576}}},
+        {{{2, 1.122, 1.987, 17.394}, {4, 1.096, 0.883, 15.557}}},
+    }},
+}};
+
+// Clamps a predicted bound so that a null window around it does not overflow.
+int window_bound(double bound)
+{
+    return int(std::clamp(bound, double(INT_MIN) + 1, double(INT_MAX) - 1));
+}
+
+// Tries the probcut checks of a node with depth plies left. Returns true
+// when the node can be cut, with the bound to return in result.
+bool probcut_cut(const game &g, int depth, int alpha, int beta, double threshold,
+    const score::function &score, const probcut_table &table, int &result, int ply = 0);
+
+int probcut(const game &g, int depth, int alpha, int beta, double threshold,
+    const score::function &score, const probcut_table &table, int ply = 0)
+{
+    statistics &stats = counters();
+    stats.node(ply);
+    if (g.is_game_over()) {
+        stats.leaves++;
+        stats.endgame++;
+        return score::terminal(g);
+    }
+
+    if (int decided = score::decided_by_stability(g)) {
+        stats.leaves++;
+        stats.endgame++;
+        return decided;
+    }
+
+    if (depth <= 0) {
+        stats.leaves++;
+        return score(g);
+    }
+
+    if (depth == 1)
+        if (score::batch_function evaluate = score::batched(score))
+            return alphabeta_preleaf(g, alpha, beta, evaluate, ply);
+
+    int cut;
+    if (probcut_cut(g, depth, alpha, beta, threshold, score, table, cut, ply))
+        return cut;
+
+    bool maximize = g.player() == white;
+    int best = maximize ? INT_MIN : INT_MAX;
+    bool first = true;
+    for (bitpos p : g.possible_place_positions()) {
+        int current = probcut(g.test_piece(p), depth - 1, alpha, beta, threshold, score, table, ply + 1);
+        if (maximize) {
+            best = std::max(best, current);
+            alpha = std::max(alpha, best);
+        } else {
+            best = std::min(best, current);
+            beta = std::min(beta, best);
+        }
+        if (alpha >= beta) {
+            stats.cutoff(first);
+            break;
+        }
+        first = false;
+    }
+    return best;
+}
+
+bool probcut_cut(const game &g, int depth, int alpha, int beta, double threshold,
+    const score::function &score, const probcut_table &table, int &result, int ply)
+{
+    if (depth < probcut_min_depth)
+        return false;
+
+    int phase = probcut_phase(g.count<any>());
+    int row = std::min(depth, probcut_max_depth) - probcut_min_depth;
+    for (const probcut_check &check : table[phase][row]) {
+        if (check.shallow_depth == 0 || check.a <= 0)
+            continue;
+
+        double margin = threshold * check.sigma;
+        double offset = (g.player() == white) ? check.b : -check.b;
+        if (beta != INT_MAX) {
+            int b = window_bound(std::ceil((beta + margin - offset) / check.a));
+            if (probcut(g, check.shallow_depth, b - 1, b, threshold, score, table, ply) >= b) {
+                counters().probcut_cuts++;
+                result = beta;
+                return true;
+            }
+        }
+        if (alpha != INT_MIN) {
+            int a = window_bound(std::floor((alpha - margin - offset) / check.a));
+            if (probcut(g, check.shallow_depth, a, a + 1, threshold, score, table, ply) <= a) {
+                counters().probcut_cuts++;
+                result = alpha;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Sequence of moves expected from a position, best move first.
+struct line {
+    bitpos moves[60];
+    int length = 0;
+
+    void set(bitpos p, const line &rest)
+    {
+        moves[0] = p;
+        length = std::min(rest.length, 59);
+        std::copy(rest.moves, rest.moves + length, moves + 1);
+        length++;
+    }
+
+    bool starts_with(const line &prefix) const
+    {
+        return prefix.length <= length && std::equal(prefix.moves, prefix.moves + prefix.length, moves);
+    }
+
+    std::vector<bitpos> to_vector() const
+    {
+        return std::vector<bitpos>(moves, moves + length);
+    }
+};
+
+struct settings {
+    int depth = 8;
+    score::function score = score::mobility_frontier;
+    // Multi-ProbCut threshold, plain alpha-beta when 0
+    double probcut_threshold = 0;
+    const probcut_table *table = &probcut_mobility_frontier;
+    // half width of the first window around the previous iteration score
+    int aspiration = 8;
+    // shared by every searcher given the same table, none when null
+    std::shared_ptr<transposition_table> transpositions;
+};
+
+// Bounds of a single search, on top of the searcher settings.
+struct limits {
+    int depth = 0; // settings depth when 0
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    const std::atomic<bool> *stop = nullptr;
+};
+
+struct result {
+    int score = 0;
+    int depth = 0; // of the last completed iteration
+    std::vector<bitpos> pv;
+    statistics stats; // of every iteration
+
+    bitpos best_move() const { return pv.empty() ? 0 : pv.front(); }
+};
+
+// Iterative deepening search keeping its principal variation. Every
+// iteration starts with an aspiration window around the score of the
+// previous one and tries the previous principal variation first. The
+// line expected from the last search also seeds the next one, when the
+// game went on along it.
+class searcher {
+    settings config;
+    score::batch_function batched;
+    game last_root;
+    result last_result;
+    line seed;
+    positions root_moves;
+    limits bounds;
+    unsigned long long nodes = 0;
+    bool out_of_time = false;
+
+    bool stopped()
+    {
+        if (bounds.stop && bounds.stop->load(std::memory_order_relaxed))
+            return true;
+        // reading the clock is not free, only do it every 1024 nodes
+        if (!out_of_time && (nodes & 1023) == 0
+            && bounds.deadline != std::chrono::steady_clock::time_point::max())
+            out_of_time = std::chrono::steady_clock::now() >= bounds.deadline;
+        return out_of_time;
+    }
+
+    int node(const game &g, int depth, int alpha, int beta, line &pv, int ply, bool on_pv)
+    {
+        pv.length = 0;
+        nodes++;
+        if (stopped())
+            return 0; // discarded by search
+
+        statistics &stats = counters();
+        stats.node(ply);
+        if (g.is_game_over()) {
+            stats.leaves++;
+            stats.endgame++;
+            return score::terminal(g);
+        }
+
+        uint64 key = config.transpositions ? g.hash() : 0;
+        transposition_table::entry e = {0, 0, exact, 0};
+        bool found = config.transpositions && config.transpositions->probe(key, e);
+        if (config.transpositions) {
+            stats.table_probes++;
+            stats.table_hits += found;
+        }
+
+        // the root always searches to report a line
+        if (ply > 0) {
+            if (int decided = score::decided_by_stability(g)) {
+                stats.leaves++;
+                stats.endgame++;
+                return decided;
+            }
+
+            if (depth <= 0) {
+                stats.leaves++;
+                return config.score(g);
+            }
+
+            if (found && e.depth >= depth) {
+                if (e.bound == exact
+                    || (e.bound == lower && e.score >= beta)
+                    || (e.bound == upper && e.score <= alpha))
+                    return e.score;
+            }
+
+            int cut;
+            if (config.probcut_threshold > 0 && probcut_cut(g, depth, alpha, beta,
+                    config.probcut_threshold, config.score, *config.table, cut, ply))
+                return cut;
+        }
+
+        positions possible_places = (ply == 0) ? root_moves : g.possible_place_positions();
+        bitpos hint = (on_pv && ply < seed.length) ? seed.moves[ply] & possible_places.bitmap : 0;
+        bitpos first = hint ? hint : e.move & possible_places.bitmap;
+
+        int alpha_start = alpha, beta_start = beta;
+        bool maximize = g.player() == white;
+        int best = maximize ? INT_MIN : INT_MAX;
+        line child_pv;
+        bool tried = false;
+
+        // one ply above the leaves, each child is scored by the batch
+        // evaluator as a batch of one, see alphabeta_preleaf; leaves neither probe nor fill the table, so nothing
+        // else changes
+        auto child = [&](bitpos p) {
+            if (depth != 1 || ply == 0 || !batched)
+                return node(g.test_piece(p), depth - 1, alpha, beta, child_pv, ply + 1, p == hint);
+            int current;
+            uint64 endgame;
+            score::score_children(g, {p}, batched, &current, endgame);
+            nodes++;
+            stats.node(ply + 1);
+            stats.leaves++;
+            stats.endgame += popcount(endgame);
+            child_pv.length = 0;
+            return current;
+        };
+        auto visit = [&](bitpos p) {
+            int current = child(p);
+            if (pv.length == 0 || (maximize ? current > best : current < best)) {
+                best = current;
+                pv.set(p, child_pv);
+            }
+            if (maximize)
+                alpha = std::max(alpha, best);
+            else
+                beta = std::min(beta, best);
+            bool cut = alpha >= beta;
+            if (cut)
+                stats.cutoff(!tried);
+            tried = true;
+            return cut;
+        };
+
+        // the table slot of the next sibling loads while this one is
+        // searched; lower, making the sibling costs more than the miss
+        auto prefetch = [&](bitmap8x8 next) {
+            if (next && depth >= 3 && config.transpositions)
+                config.transpositions->prefetch(g.test_piece(next & -next).hash());
+        };
+        bitmap8x8 others = possible_places.bitmap & ~first;
+        bool cut = false;
+        if (first) {
+            prefetch(others);
+            cut = visit(first);
+        }
+        while (!cut && others) {
+            bitpos p = others & -others;
+            others ^= p;
+            prefetch(others);
+            cut = visit(p);
+        }
+
+        // a root restricted to some moves does not score the position
+        bool partial = ply == 0 && root_moves.bitmap != g.possible_place_positions().bitmap;
+        if (config.transpositions && !stopped() && !partial) {
+            bound_type bound = exact;
+            if (best <= alpha_start)
+                bound = upper;
+            else if (best >= beta_start)
+                bound = lower;
+            config.transpositions->store(key, {best, depth, bound, pv.moves[0]});
+        }
+        return best;
+    }
+
+    int aspiration_search(const game &g, int depth, int guess, line &pv)
+    {
+        if (guess == INT_MIN || guess == INT_MAX) // decided, nothing to aspire to
+            return node(g, depth, INT_MIN, INT_MAX, pv, 0, true);
+
+        long long delta = config.aspiration;
+        auto bound = [](long long v) { return int(std::clamp<long long>(v, INT_MIN, INT_MAX)); };
+        int alpha = bound(guess - delta);
+        int beta = bound(guess + delta);
+        for (;;) {
+            int score = node(g, depth, alpha, beta, pv, 0, true);
+            delta *= 4;
+            if (stopped())
+                return score;
+            else if (score <= alpha && alpha != INT_MIN)
+                alpha = bound(guess - delta); // fail low
+            else if (score >= beta && beta != INT_MAX)
+                beta = bound(guess + delta); // fail high
+            else
+                return score;
+        }
+    }
+
+public:
+    std::function<void(const game &, const result &)> report;
+
+    explicit searcher(const settings &s = settings())
+        : config(s), batched(score::batched(s.score))
+    {}
+
+    const settings &get_settings() const { return config; }
+
+    // Rest of the last principal variation when g was reached along it.
+    line expected_line(const game &g) const
+    {
+        line expected;
+        game current = last_root;
+        const auto &pv = last_result.pv;
+        for (unsigned k = 0; k <= pv.size(); k++) {
+            if (current == g) {
+                for (unsigned i = k; i < pv.size(); i++)
+                    expected.moves[expected.length++] = pv[i];
+                break;
+            }
+            if (k == pv.size() || !current.place_piece(pv[k]))
+                break;
+        }
+        return expected;
+    }
+
+    result search(const game &g)
+    {
+        return search(g, g.possible_place_positions());
+    }
+
+    // Searches until the depth limit, the deadline or until stop is raised.
+    // An interrupted search returns the result of its last completed
+    // iteration, which is empty if even the first one did not complete.
+    result search(const game &g, positions moves, const limits &l = limits())
+    {
+        collect collected;
+        bounds = l;
+        nodes = 0;
+        out_of_time = false;
+        root_moves = moves;
+        seed = expected_line(g);
+
+        result r;
+        line pv;
+        int score = 0;
+        int max_depth = bounds.depth ? bounds.depth : config.depth;
+        for (int depth = 1; depth <= max_depth; depth++) {
+            trace::scope traced("iteration", "search", depth);
+            auto start = std::chrono::steady_clock::now();
+            score = (depth == 1)
+                ? node(g, 1, INT_MIN, INT_MAX, pv, 0, true)
+                : aspiration_search(g, depth, score, pv);
+            counters().iteration(depth, std::chrono::steady_clock::now() - start);
+            if (stopped())
+                break;
+            r = {score, depth, pv.to_vector()};
+            // the line kept from the last search orders the plies past the
+            // end of the new one for as long as they agree
+            if (!seed.starts_with(pv))
+                seed = pv;
+        }
+        bounds = limits();
+        r.stats = collected.get();
+
+        remember(g, r);
+        return r;
+    }
+
+    // Takes r, searched elsewhere from g, as the result of the last search.
+    void remember(const game &g, const result &r)
+    {
+        last_root = g;
+        last_result = r;
+        if (report)
+            report(g, last_result);
+    }
+
+    const result &last() const { return last_result; }
+};
+
+}
+
+#endif // OTHELLO_SEARCH_H
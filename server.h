@@ -0,0 +1,409 @@
+#ifndef OTHELLO_SERVER_H
+#define OTHELLO_SERVER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core.h"
+#include "io.h"
+#include "pool.h"
+#include "report.h"
+#include "search.h"
+#include "strategy.h"
+
+namespace othello {
+
+// Many games served at once, one command per line prefixed by the game
+// session it is for:
+//
+//   <id> new [depth N] [time MS] [color white|black] [strategy NAME]
+//                            starts a game in which the server plays color,
+//                            white by default, within MS per move, with the
+//                            iterative deepening search, "search", or
+//                            "random", "minmax", "alphabeta" or "probcut"
+//                            searching N plies; those answer in their own
+//                            time, the deadline only ordering the queue
+//   <id> move <pos>          plays the client move
+//   <id> close               ends the session
+//   stats                    answers "stats sessions N moves M missed K ..."
+//   quit                     answers the moves being searched and exits
+//
+// Sessions answer "<id> ok" when the client is to move, "<id> bestmove
+// <pos> depth D" for each server move, "<id> gameover winner <color>" and
+// "<id> error <reason>".
+//
+// Every session searches on one shared pool, earliest deadline first: a
+// move waiting in line gets less time, never more than its own, so each
+// answers within its time control however many sessions are waiting.
+// A session has one move searched at most, so none starves the others.
+// The sessions share a transposition table split into partitions, a fixed
+// amount of memory whatever their number.
+class game_server {
+public:
+    typedef std::chrono::steady_clock clock;
+
+    struct options {
+        unsigned threads = thread_pool::default_size();
+        // log2 of the entries of all the partitions
+        int table_size_log2 = 22;
+        unsigned partitions = 16;
+        search::settings search = search::settings();
+        std::chrono::milliseconds move_time{1000}; // when new gives none
+    };
+
+    struct stats {
+        unsigned sessions = 0;
+        unsigned long long moves = 0;
+        unsigned long long missed = 0; // answered after their deadline
+        double seconds = 0;
+        report::latency latency; // from the client move to the answer
+    };
+
+private:
+    struct session {
+        std::string id;
+        std::mutex mutex;
+        game position;
+        piece_color color = white; // of the server
+        int depth = 0;
+        std::chrono::milliseconds move_time;
+        std::unique_ptr<search::searcher> searcher;
+        strategy strat; // played instead of the searcher when set
+        bool busy = false; // a move of the server is queued or searched
+        bool closed = false;
+    };
+
+    struct request {
+        clock::time_point deadline;
+        clock::time_point arrival;
+        uint64 sequence;
+        std::shared_ptr<session> s;
+
+        // the top of a priority queue is its greatest element
+        bool operator<(const request &o) const
+        {
+            return deadline != o.deadline ? deadline > o.deadline : sequence > o.sequence;
+        }
+    };
+
+    static constexpr unsigned max_samples = 1 << 16;
+
+    options config;
+    std::function<void(const std::string &)> reply;
+    std::vector<std::shared_ptr<search::transposition_table>> partitions;
+
+    std::mutex sessions_mutex;
+    std::map<std::string, std::shared_ptr<session>> sessions;
+    unsigned opened = 0;
+
+    std::mutex queue_mutex;
+    std::priority_queue<request> queue;
+    uint64 sequence = 0;
+
+    std::mutex stats_mutex;
+    std::vector<float> latencies; // the last max_samples, in us
+    unsigned long long moves = 0;
+    unsigned long long missed = 0;
+    clock::time_point start = clock::now();
+
+    thread_pool pool; // destroyed first, answering the queued moves
+
+    std::shared_ptr<session> find(const std::string &id)
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex);
+        auto i = sessions.find(id);
+        return i == sessions.end() ? nullptr : i->second;
+    }
+
+    // s->busy is set, the server being to move in s.
+    void enqueue(std::shared_ptr<session> s, std::chrono::milliseconds move_time)
+    {
+        auto now = clock::now();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            queue.push({now + move_time, now, sequence++, std::move(s)});
+        }
+        pool.submit([this] { search_earliest(); });
+    }
+
+    void record(clock::time_point arrival, clock::time_point deadline)
+    {
+        auto now = clock::now();
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        float us = std::chrono::duration<float, std::micro>(now - arrival).count();
+        if (latencies.size() < max_samples)
+            latencies.push_back(us);
+        else
+            latencies[moves % max_samples] = us;
+        moves++;
+        missed += now > deadline;
+    }
+
+    // Strategy called name searching depth plies, nullptr for the
+    // searcher; false for an unknown name.
+    bool named_strategy(const std::string &name, int depth, strategy &s) const
+    {
+        if (name == "search")
+            s = nullptr;
+        else if (name == "random")
+            s = strat::random_strategy;
+        else if (name == "minmax")
+            s = strat::minmax_strategy(depth, config.search.score);
+        else if (name == "alphabeta")
+            s = strat::alphabeta_strategy(depth, config.search.score);
+        else if (name == "probcut")
+            s = strat::probcut_strategy(depth);
+        else
+            return false;
+        return true;
+    }
+
+    // Each pool task searches the request closest to its deadline, not
+    // necessarily the one it was submitted for.
+    void search_earliest()
+    {
+        request r;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            r = queue.top();
+            queue.pop();
+        }
+        session &s = *r.s;
+        game g;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.closed)
+                return;
+            g = s.position;
+        }
+
+        // only this task uses the searcher or strategy of a busy session
+        bitpos best;
+        int depth;
+        if (s.strat) {
+            best = s.strat(g, g.player(), g.possible_place_positions());
+            depth = s.depth;
+        } else {
+            search::result result = s.searcher->search(g, g.possible_place_positions(),
+                {.depth = s.depth, .deadline = r.deadline});
+            best = result.best_move();
+            depth = result.depth;
+        }
+        if (!best) // out of time before the first iteration
+            best = *g.possible_place_positions().begin();
+
+        std::vector<std::string> answers;
+        bool again = false;
+        std::chrono::milliseconds move_time;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (s.closed)
+                return;
+            s.position.place_piece(best);
+            answers.push_back(s.id + " bestmove " + io::to_string(pos::from_bitpos(best))
+                + " depth " + std::to_string(depth));
+            if (s.position.is_game_over())
+                answers.push_back(s.id + " gameover winner " + io::to_string(s.position.winner()));
+            again = !s.position.is_game_over() && s.position.player() == s.color;
+            s.busy = again;
+            move_time = s.move_time;
+        }
+        record(r.arrival, r.deadline);
+        for (auto &a : answers)
+            reply(a);
+        if (again) // the client passes
+            enqueue(r.s, move_time);
+    }
+
+    void open(const std::string &id, std::istringstream &args)
+    {
+        auto s = std::make_shared<session>();
+        s->id = id;
+        s->depth = config.search.depth;
+        s->move_time = config.move_time;
+        std::string key, value, strategy_name = "search";
+        while (args >> key >> value) {
+            long n = atol(value.c_str());
+            if (key == "depth" && n > 0) {
+                s->depth = n;
+            } else if (key == "time" && n > 0) {
+                s->move_time = std::chrono::milliseconds(n);
+            } else if (key == "color" && (value == "white" || value == "black")) {
+                s->color = value == "white" ? white : black;
+            } else if (key == "strategy" && named_strategy(value, 1, s->strat)) {
+                strategy_name = value;
+            } else {
+                reply(id + " error invalid option " + key + " " + value);
+                return;
+            }
+        }
+
+        named_strategy(strategy_name, s->depth, s->strat); // at the final depth
+
+        std::shared_ptr<session> previous;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            search::settings settings = config.search;
+            settings.transpositions = partitions[opened++ % partitions.size()];
+            if (!s->strat)
+                s->searcher = std::make_unique<search::searcher>(settings);
+            previous = std::exchange(sessions[id], s);
+        }
+        if (previous) {
+            std::lock_guard<std::mutex> lock(previous->mutex);
+            previous->closed = true;
+        }
+
+        if (s->position.player() == s->color) {
+            s->busy = true;
+            enqueue(s, s->move_time);
+        } else {
+            reply(id + " ok");
+        }
+    }
+
+    void move(const std::string &id, std::istringstream &args)
+    {
+        std::shared_ptr<session> s = find(id);
+        if (!s) {
+            reply(id + " error unknown session");
+            return;
+        }
+        std::string token, answer;
+        pos p;
+        bool queued = false;
+        std::chrono::milliseconds move_time;
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            if (s->busy)
+                answer = "error not your turn";
+            else if (!(args >> token) || !io::parse_pos(token, p) || !s->position.place_piece(p))
+                answer = "error illegal move " + token;
+            else if (s->position.is_game_over())
+                answer = "gameover winner " + io::to_string(s->position.winner());
+            else if (s->position.player() != s->color)
+                answer = "ok"; // the server passes
+            else
+                queued = s->busy = true;
+            move_time = s->move_time;
+        }
+        if (queued)
+            enqueue(s, move_time);
+        else
+            reply(id + " " + answer);
+    }
+
+    void close(const std::string &id)
+    {
+        std::shared_ptr<session> s;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            auto i = sessions.find(id);
+            if (i != sessions.end()) {
+                s = i->second;
+                sessions.erase(i);
+            }
+        }
+        if (!s) {
+            reply(id + " error unknown session");
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(s->mutex);
+            s->closed = true;
+        }
+        reply(id + " ok");
+    }
+
+public:
+    // reply is called from execute and from the pool threads, possibly at
+    // the same time.
+    game_server(const options &o, std::function<void(const std::string &)> reply_)
+        : config(o), reply(std::move(reply_)), pool(std::max(1u, o.threads))
+    {
+        unsigned n = std::max(1u, config.partitions);
+        int split = 0;
+        while ((1u << split) < n)
+            split++;
+        int partition_log2 = std::max(10, config.table_size_log2 - split);
+        for (unsigned i = 0; i < n; i++)
+            partitions.push_back(std::make_shared<search::transposition_table>(partition_log2));
+    }
+
+    // Memory of the table partitions, e.g. "16 partitions of 4 MB on ..."
+    std::string describe_table() const
+    {
+        return std::to_string(partitions.size()) + " partitions of " + partitions[0]->allocation().describe();
+    }
+
+    stats statistics()
+    {
+        stats st;
+        {
+            std::lock_guard<std::mutex> lock(sessions_mutex);
+            st.sessions = sessions.size();
+        }
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        st.moves = moves;
+        st.missed = missed;
+        st.seconds = std::chrono::duration<double>(clock::now() - start).count();
+        st.latency = report::latency::of(latencies);
+        return st;
+    }
+
+    // Runs one command, returns false on quit.
+    bool execute(const std::string &line)
+    {
+        std::istringstream args(line);
+        std::string id, command;
+        if (!(args >> id))
+            return true;
+        if (id == "quit")
+            return false;
+        if (id == "stats") {
+            stats st = statistics();
+            std::ostringstream s;
+            s << "stats sessions " << st.sessions << " moves " << st.moves << " missed " << st.missed
+                << " moves/s " << unsigned(st.moves / std::max(st.seconds, 1e-9))
+                << " p50 " << unsigned(st.latency.p50) << " p99 " << unsigned(st.latency.p99)
+                << " max " << unsigned(st.latency.max) << " us";
+            reply(s.str());
+            return true;
+        }
+
+        args >> command;
+        if (command == "new")
+            open(id, args);
+        else if (command == "move")
+            move(id, args);
+        else if (command == "close")
+            close(id);
+        else
+            reply(id + " error unknown command " + command);
+        return true;
+    }
+
+    // Serves until quit or the end of the input, then answers the moves
+    // being searched.
+    void run(std::istream &in)
+    {
+        std::string line;
+        while (std::getline(in, line) && execute(line)) {}
+        pool.wait();
+    }
+};
+
+}
+
+#endif // OTHELLO_SERVER_H
@@ -0,0 +1,352 @@
+#ifndef OTHELLO_SOLVE_H
+#define OTHELLO_SOLVE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+#include "table.h"
+#include "trace.h"
+
+namespace othello::search {
+
+// Exact endgame solver: the final disc difference, white minus black,
+// under perfect play from both sides. It searches raw bitmaps from the
+// point of view of the player to move.
+//
+// With several threads, nodes with enough empty squares are split the
+// Young Brothers Wait way: the first child is searched alone, then its
+// siblings are queued at once and run by whichever threads are free. Each
+// thread queues on its own deque and takes its newest task first, idle
+// threads steal the oldest task of another deque, the biggest subtree. A
+// thread waiting for the siblings of a split runs queued tasks meanwhile.
+// A sibling failing high cancels the searches of the others. Every thread
+// shares one lock-free table, so the score is the serial one whatever the
+// interleaving: searches are cancelled only once their result is unused,
+// and cancelled searches store nothing.
+struct solve_settings {
+    unsigned threads = 1;
+    // smallest number of empty squares of a node searched in parallel
+    int split_empties = 12;
+    // smallest number of empty squares of a node stored in the table
+    int table_empties = 7;
+    // smallest number of empty squares where moves are ordered by the
+    // mobility they leave to the opponent, fewest first
+    int order_empties = 8;
+    // shared by the solves given the same table, own one when null
+    std::shared_ptr<transposition_table> table;
+};
+
+struct solve_result {
+    int score = 0; // final white - black disc difference
+    bitpos best = 0; // of the player to move, 0 when the game is over
+    unsigned long long nodes = 0;
+    double seconds = 0;
+};
+
+class endgame_solver {
+    // Node whose siblings run in parallel, alive on the stack of the thread
+    // which split it until they are all done.
+    struct split_point {
+        std::mutex mutex; // of alpha, best and best_move
+        int alpha;
+        int beta;
+        int best;
+        bitpos best_move;
+        std::atomic<int> pending;
+        std::atomic<bool> cutoff{false};
+        split_point *parent;
+    };
+
+    struct task {
+        bitmap8x8 player, opponent; // after the move
+        bitpos move;
+        split_point *split;
+    };
+
+    struct work_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    solve_settings config;
+    std::vector<std::unique_ptr<work_queue>> queues;
+    std::atomic<unsigned long long> total_nodes{0};
+    std::atomic<bool> done{false};
+
+    static int thread_index(int i = -1)
+    {
+        thread_local int index = 0;
+        if (i >= 0)
+            index = i;
+        return index;
+    }
+
+    static bool cancelled(const split_point *sp)
+    {
+        for (; sp; sp = sp->parent)
+            if (sp->cutoff.load(std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    static uint64 key(bitmap8x8 player, bitmap8x8 opponent)
+    {
+        return board8x8(player, opponent).hash();
+    }
+
+    // Takes the newest task of the calling thread, else the oldest one of
+    // another thread.
+    bool take(task &t)
+    {
+        int self = thread_index();
+        for (unsigned i = 0; i < queues.size(); i++) {
+            work_queue &q = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tasks.empty())
+                continue;
+            if (i == 0) {
+                t = q.tasks.back();
+                q.tasks.pop_back();
+            } else {
+                t = q.tasks.front();
+                q.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    bool run_one()
+    {
+        task t;
+        if (!take(t))
+            return false;
+        run(t);
+        return true;
+    }
+
+    void run(const task &t)
+    {
+        split_point *sp = t.split;
+        if (!cancelled(sp)) {
+            int alpha;
+            {
+                std::lock_guard<std::mutex> lock(sp->mutex);
+                alpha = sp->alpha;
+            }
+            unsigned long long nodes = 0;
+            bitpos ignored;
+            int v = -search(t.player, t.opponent, -sp->beta, -alpha, sp, nodes, ignored);
+            total_nodes += nodes;
+            if (!cancelled(sp)) {
+                std::lock_guard<std::mutex> lock(sp->mutex);
+                if (v > sp->best) {
+                    sp->best = v;
+                    sp->best_move = t.move;
+                    if (v > sp->alpha)
+                        sp->alpha = v;
+                    if (v >= sp->beta)
+                        sp->cutoff = true;
+                }
+            }
+        }
+        sp->pending--;
+    }
+
+    // Moves of player in search order, best guess first.
+    int order(bitmap8x8 player, bitmap8x8 opponent, bitmap8x8 moves, int empties, bitpos first,
+        bitpos *ordered) const
+    {
+        int n = 0;
+        if (first & moves) {
+            ordered[n++] = first;
+            moves ^= first;
+        }
+        int start = n;
+        int mobility[64];
+        for (bitpos p : positions{moves}) {
+            if (empties >= config.order_empties) {
+                bitmap8x8 flips = flipped(util::to_index(p), player, opponent);
+                board8x8 child(opponent & ~flips, player | flips | p);
+                mobility[n] = popcount(child.moves<white>());
+            }
+            ordered[n++] = p;
+        }
+        if (empties >= config.order_empties) {
+            // insertion sort, a dozen moves at most in practice
+            for (int i = start + 1; i < n; i++) {
+                for (int j = i; j > start && mobility[j] < mobility[j - 1]; j--) {
+                    std::swap(mobility[j], mobility[j - 1]);
+                    std::swap(ordered[j], ordered[j - 1]);
+                }
+            }
+        }
+        return n;
+    }
+
+    // Fail soft negamax score of the player to move, in discs.
+    int search(bitmap8x8 player, bitmap8x8 opponent, int alpha, int beta, split_point *sp,
+        unsigned long long &nodes, bitpos &best_move)
+    {
+        nodes++;
+        best_move = 0;
+        if (sp && cancelled(sp))
+            return 0; // discarded
+
+        board8x8 board(player, opponent);
+        bitmap8x8 moves = board.moves<white>();
+        if (!moves) {
+            if (!board.moves<black>())
+                return popcount(player) - popcount(opponent);
+            bitpos ignored;
+            return -search(opponent, player, -beta, -alpha, sp, nodes, ignored);
+        }
+
+        int empties = popcount(~(player | opponent));
+        uint64 k = 0;
+        transposition_table::entry e = {0, 0, exact, 0};
+        if (empties >= config.table_empties) {
+            k = key(player, opponent);
+            if (config.table->probe(k, e)
+                && (e.bound == exact
+                    || (e.bound == lower && e.score >= beta)
+                    || (e.bound == upper && e.score <= alpha))) {
+                best_move = e.move;
+                return e.score;
+            }
+        }
+
+        bitpos ordered[64];
+        int n = order(player, opponent, moves, empties, e.move, ordered);
+        int alpha_start = alpha;
+        int best = -65;
+        auto child = [&](int i) {
+            bitmap8x8 flips = flipped(util::to_index(ordered[i]), player, opponent);
+            bitpos ignored;
+            return -search(opponent & ~flips, player | flips | ordered[i], -beta, -alpha, sp, nodes, ignored);
+        };
+
+        // the table slot of the next sibling loads while this one is searched
+        auto prefetch = [&](int i) {
+            if (i < n && empties > config.table_empties) {
+                bitmap8x8 flips = flipped(util::to_index(ordered[i]), player, opponent);
+                config.table->prefetch(key(opponent & ~flips, player | flips | ordered[i]));
+            }
+        };
+
+        int i = 0;
+        bool parallel = queues.size() > 1 && empties >= config.split_empties;
+        for (; i < n && (i == 0 || !parallel); i++) {
+            prefetch(i + 1);
+            int v = child(i);
+            if (v > best) {
+                best = v;
+                best_move = ordered[i];
+                alpha = std::max(alpha, v);
+                if (v >= beta)
+                    break;
+            }
+        }
+
+        if (parallel && i < n && best < beta) {
+            split_point split;
+            split.alpha = alpha;
+            split.beta = beta;
+            split.best = best;
+            split.best_move = best_move;
+            split.pending = n - i;
+            split.parent = sp;
+            {
+                work_queue &own = *queues[thread_index()];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                for (; i < n; i++) {
+                    bitmap8x8 flips = flipped(util::to_index(ordered[i]), player, opponent);
+                    own.tasks.push_back({opponent & ~flips, player | flips | ordered[i], ordered[i], &split});
+                }
+            }
+            while (split.pending.load() > 0) {
+                if (!run_one())
+                    std::this_thread::yield();
+            }
+            best = split.best;
+            best_move = split.best_move;
+        }
+
+        if (sp && cancelled(sp))
+            return 0;
+        if (k) {
+            bound_type bound = best <= alpha_start ? upper : best >= beta ? lower : exact;
+            config.table->store(k, {best, empties, bound, best_move});
+        }
+        return best;
+    }
+
+    void work(int index)
+    {
+        thread_index(index);
+        while (!done.load()) {
+            if (!run_one())
+                std::this_thread::yield();
+        }
+    }
+
+public:
+    explicit endgame_solver(const solve_settings &s = solve_settings())
+        : config(s)
+    {
+        if (!config.table)
+            config.table = std::make_shared<transposition_table>();
+        config.threads = std::max(1u, config.threads);
+    }
+
+    const solve_settings &get_settings() const { return config; }
+
+    solve_result solve(const game &g)
+    {
+        trace::scope traced("solve", "endgame", popcount(g.bitmap<none>()));
+        auto start = std::chrono::steady_clock::now();
+        queues.clear();
+        for (unsigned i = 0; i < config.threads; i++)
+            queues.push_back(std::make_unique<work_queue>());
+        total_nodes = 0;
+        done = false;
+
+        std::vector<std::thread> helpers;
+        for (unsigned i = 1; i < config.threads; i++)
+            helpers.emplace_back(&endgame_solver::work, this, i);
+
+        thread_index(0);
+        bitmap8x8 player = g.player() == white ? g.bitmap<white>() : g.bitmap<black>();
+        bitmap8x8 opponent = g.player() == white ? g.bitmap<black>() : g.bitmap<white>();
+        unsigned long long nodes = 0;
+        solve_result r;
+        int score = search(player, opponent, -65, 65, nullptr, nodes, r.best);
+        r.score = g.player() == white ? score : -score;
+        if (g.is_game_over())
+            r.best = 0;
+
+        done = true;
+        for (auto &h : helpers)
+            h.join();
+        r.nodes = nodes + total_nodes;
+        r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return r;
+    }
+};
+
+// Exact score of g, white - black discs at the end of perfect play.
+int solve(const game &g, unsigned threads = 1)
+{
+    return endgame_solver({.threads = threads}).solve(g).score;
+}
+
+}
+
+#endif // OTHELLO_SOLVE_H
@@ -0,0 +1,129 @@
+#ifndef OTHELLO_STATS_H
+#define OTHELLO_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+namespace othello::search {
+
+// Counters of the searches run on a thread. Every search adds to the
+// counters of its own thread, see collect, and results searched on other
+// threads are merged in by whoever uses them.
+struct statistics {
+    static constexpr int max_plies = 64;
+
+    unsigned long long nodes = 0;
+    unsigned long long leaves = 0; // evaluated or decided positions
+    std::array<unsigned long long, max_plies> nodes_per_ply{};
+    unsigned long long cutoffs = 0;
+    unsigned long long first_move_cutoffs = 0; // cutoffs by the first move tried
+    unsigned long long probcut_cuts = 0;
+    unsigned long long table_probes = 0;
+    unsigned long long table_hits = 0;
+    unsigned long long endgame = 0; // handed to the endgame: over or decided by stable discs
+
+    // iterations of the iterative deepening searches, by depth
+    std::array<unsigned long long, max_plies> iterations{};
+    std::array<std::chrono::nanoseconds, max_plies> iteration_time{};
+
+    void node(int ply)
+    {
+        nodes++;
+        nodes_per_ply[std::min(ply, max_plies - 1)]++;
+    }
+
+    void cutoff(bool first)
+    {
+        cutoffs++;
+        first_move_cutoffs += first;
+    }
+
+    void iteration(int depth, std::chrono::nanoseconds time)
+    {
+        iterations[std::min(depth, max_plies - 1)]++;
+        iteration_time[std::min(depth, max_plies - 1)] += time;
+    }
+
+    void merge(const statistics &o)
+    {
+        nodes += o.nodes;
+        leaves += o.leaves;
+        cutoffs += o.cutoffs;
+        first_move_cutoffs += o.first_move_cutoffs;
+        probcut_cuts += o.probcut_cuts;
+        table_probes += o.table_probes;
+        table_hits += o.table_hits;
+        endgame += o.endgame;
+        for (int i = 0; i < max_plies; i++) {
+            nodes_per_ply[i] += o.nodes_per_ply[i];
+            iterations[i] += o.iterations[i];
+            iteration_time[i] += o.iteration_time[i];
+        }
+    }
+
+    int max_ply() const
+    {
+        int ply = max_plies - 1;
+        while (ply > 0 && nodes_per_ply[ply] == 0)
+            ply--;
+        return ply;
+    }
+
+    // Geometric mean of the growth of the tree from one ply to the next.
+    double branching_factor() const
+    {
+        int first = 0, last = max_ply();
+        while (first < last && nodes_per_ply[first] == 0)
+            first++;
+        if (first == last)
+            return 0;
+        return std::pow(double(nodes_per_ply[last]) / nodes_per_ply[first], 1.0 / (last - first));
+    }
+
+    double first_move_cutoff_rate() const
+    {
+        return cutoffs ? double(first_move_cutoffs) / cutoffs : 0;
+    }
+
+    double table_hit_rate() const
+    {
+        return table_probes ? double(table_hits) / table_probes : 0;
+    }
+};
+
+// Counters of the calling thread.
+statistics &counters()
+{
+    thread_local statistics thread_counters;
+    return thread_counters;
+}
+
+// Collects the counters of the searches run on the calling thread while it
+// lives. They are added to the enclosing collection on destruction.
+class collect {
+    statistics enclosing;
+
+public:
+    collect()
+        : enclosing(counters())
+    {
+        counters() = statistics();
+    }
+
+    ~collect()
+    {
+        enclosing.merge(counters());
+        counters() = enclosing;
+    }
+
+    collect(const collect &) = delete;
+    collect &operator=(const collect &) = delete;
+
+    const statistics &get() const { return counters(); }
+};
+
+}
+
+#endif // OTHELLO_STATS_H
@@ -8,12 +8,16 @@
 
 #include "core.h"
 #include "score.h"
+#include "search.h"
+#include "ponder.h"
+#include "rng.h"
+#include "trace.h"
 
 namespace othello::strat {
 
 bitpos random_strategy(const game &g, piece_color player, positions possible_positions)
 {
-    int rand_pos = rand() % possible_positions.size();
+    int rand_pos = random::below(possible_positions.size());
     for (bitpos p : possible_positions)
         if (rand_pos-- == 0)
             return p;
@@ -67,7 +71,8 @@ strategy minmax_strategy(int max_depth, score::function scoref=score::pieces_dif
         int max_score = INT_MIN;
         bitpos max_p = 0;
         for (bitpos p : possible_positions) {
-            int state_score = score::minmax_score_game_state(g.test_piece(p), max_depth, scoref);
+            trace::scope traced("root move", "search", util::to_index(p));
+            int state_score = score::minmax_score_game_state(g.test_piece(p), max_depth, scoref, 1);
             int current_score = (player == white) ? state_score : -state_score;
             if (current_score >= max_score) {
                 max_score = current_score;
@@ -78,6 +83,74 @@ strategy minmax_strategy(int max_depth, score::function scoref=score::pieces_dif
     };
 }
 
+// Picks the best move from the score of each child position, as
+// minmax_strategy does, searched by search_child(child, alpha, beta).
+template<typename search_function>
+bitpos best_child(const game &g, piece_color player, positions possible_positions, search_function search_child)
+{
+    bool maximize = player == white;
+    int alpha = INT_MIN, beta = INT_MAX;
+    bitpos best_p = 0;
+    for (bitpos p : possible_positions) {
+        trace::scope traced("root move", "search", util::to_index(p));
+        int current_score = search_child(g.test_piece(p), alpha, beta);
+        bool better = maximize ? current_score > alpha : current_score < beta;
+        if (better || best_p == 0) {
+            best_p = p;
+            if (maximize)
+                alpha = std::max(alpha, current_score);
+            else
+                beta = std::min(beta, current_score);
+        }
+    }
+    return best_p;
+}
+
+strategy alphabeta_strategy(int max_depth, score::function scoref=score::pieces_diff_score)
+{
+    return [scoref, max_depth](const game &g, piece_color player, positions possible_positions)
+    {
+        return best_child(g, player, possible_positions, [&](const game &child, int alpha, int beta) {
+            return search::alphabeta(child, max_depth, alpha, beta, scoref, 1);
+        });
+    };
+}
+
+// Multi-ProbCut search: the lower the threshold, the more aggressive the
+// pruning. The table must have been fitted for the same score function.
+strategy probcut_strategy(int max_depth, double threshold=1.0,
+    score::function scoref=score::mobility_frontier,
+    const search::probcut_table &table=search::probcut_mobility_frontier)
+{
+    return [scoref, max_depth, threshold, &table](const game &g, piece_color player, positions possible_positions)
+    {
+        return best_child(g, player, possible_positions, [&](const game &child, int alpha, int beta) {
+            return search::probcut(child, max_depth, alpha, beta, threshold, scoref, table, 1);
+        });
+    };
+}
+
+// Iterative deepening search keeping its expected line between moves. With
+// a ponderer, positions already searched on the opponent's time are played
+// right away.
+strategy search_strategy(std::shared_ptr<search::searcher> searcher,
+    std::shared_ptr<search::ponderer> ponder=nullptr)
+{
+    return [searcher, ponder](const game &g, piece_color player, positions possible_positions)
+    {
+        search::result pondered;
+        if (ponder) {
+            ponder->stop();
+            if (ponder->find(g, pondered) && (pondered.best_move() & possible_positions.bitmap)) {
+                search::counters().merge(pondered.stats); // searched on the ponder thread
+                searcher->remember(g, pondered);
+                return pondered.best_move();
+            }
+        }
+        return searcher->search(g, possible_positions).best_move();
+    };
+}
+
 strategy max_pieces = maximize_score_strategy();
 strategy minmax2 = minmax_strategy(2);
 strategy minmax4 = minmax_strategy(4);
@@ -85,6 +158,13 @@ strategy minmax8 = minmax_strategy(8);
 strategy minmax2corners = minmax_strategy(2, score::pieces_diff_with_borders_and_corners);
 strategy minmax4corners = minmax_strategy(4, score::pieces_diff_with_borders_and_corners);
 strategy max_liberty = maximize_score_strategy(score::possible_place_positions);
+strategy max_mobility = maximize_score_strategy(score::mobility_frontier);
+strategy alphabeta4 = alphabeta_strategy(4, score::mobility_frontier);
+strategy alphabeta6 = alphabeta_strategy(6, score::mobility_frontier);
+strategy probcut6 = probcut_strategy(6);
+strategy probcut8 = probcut_strategy(8);
+strategy minmax2stable = minmax_strategy(2, score::stable_pieces_diff);
+strategy minmax4stable = minmax_strategy(4, score::stable_pieces_diff);
 
 template<int steps=8>
 bitpos start_random(const game &g, piece_color player, positions possible_positions)
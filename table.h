@@ -0,0 +1,117 @@
+#ifndef OTHELLO_TABLE_H
+#define OTHELLO_TABLE_H
+
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <new>
+
+#include "core.h"
+#include "memory.h"
+
+namespace othello::search {
+
+enum bound_type {
+    upper = 1,
+    lower = 2,
+    exact = upper | lower,
+};
+
+// Transposition table shared by every search, including the ones running on
+// other threads. Each entry is two words updated without locks: the key is
+// stored xor'ed with the data, so a torn entry written concurrently by two
+// threads simply fails to match on probe.
+class transposition_table {
+public:
+    struct entry {
+        int score;
+        int depth;
+        bound_type bound;
+        bitpos move;
+    };
+
+private:
+    struct slot {
+        std::atomic<uint64> key_xor_data{0};
+        std::atomic<uint64> data{0};
+    };
+
+    large_memory memory;
+    slot *slots;
+    uint64 mask;
+
+    static constexpr uint64 pack(const entry &e)
+    {
+        uint64 move_index = e.move ? util::to_index(e.move) : 64;
+        return uint64(uint32_t(e.score))
+            | uint64(e.depth & 0xff) << 32
+            | uint64(e.bound) << 40
+            | move_index << 42;
+    }
+
+    static constexpr entry unpack(uint64 data)
+    {
+        uint64 move_index = (data >> 42) & 0x7f;
+        return {
+            int(uint32_t(data)),
+            int((data >> 32) & 0xff),
+            bound_type((data >> 40) & 0x3),
+            move_index < 64 ? util::bit(move_index) : 0,
+        };
+    }
+
+public:
+    // size_log2 is the log2 of the number of 16 bytes entries
+    explicit transposition_table(int size_log2 = 20, const memory_options &m = memory_options())
+        : memory(sizeof(slot) << size_log2, m), slots(static_cast<slot *>(memory.data())),
+          mask((uint64(1) << size_log2) - 1)
+    {
+        // mapped zeroed; constructed here, where a NUMA policy applies
+        for (uint64 i = 0; i <= mask; i++)
+            new (&slots[i]) slot;
+    }
+
+    transposition_table(const transposition_table &) = delete;
+    transposition_table &operator=(const transposition_table &) = delete;
+
+    uint64 size() const { return mask + 1; }
+
+    const large_memory &allocation() const { return memory; }
+
+    // Starts loading the slot of key, to be probed a while later.
+    void prefetch(uint64 key) const
+    {
+        __builtin_prefetch(&slots[key & mask]);
+    }
+
+    bool probe(uint64 key, entry &e) const
+    {
+        const slot &s = slots[key & mask];
+        uint64 data = s.data.load(std::memory_order_relaxed);
+        if ((s.key_xor_data.load(std::memory_order_relaxed) ^ data) != key || data == 0)
+            return false;
+        e = unpack(data);
+        return true;
+    }
+
+    // Always replaces: the latest search is the most relevant one.
+    void store(uint64 key, const entry &e)
+    {
+        slot &s = slots[key & mask];
+        uint64 data = pack(e);
+        s.data.store(data, std::memory_order_relaxed);
+        s.key_xor_data.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    void clear()
+    {
+        for (uint64 i = 0; i <= mask; i++) {
+            slots[i].data.store(0, std::memory_order_relaxed);
+            slots[i].key_xor_data.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+}
+
+#endif // OTHELLO_TABLE_H
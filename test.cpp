@@ -1,9 +1,15 @@
 
 #include <cassert>
+#include <chrono>
+#include <thread>
 #include <memory>
+#include <sstream>
 #include <iostream>
+#include <filesystem>
 
 #include "othello.h"
+#include "report.h"
+#include "capi.h"
 
 using namespace std;
 using namespace othello;
@@ -69,6 +75,42 @@ void test_bitpos_direction()
     assert(next_bitpos_is_valid(bp, directions::E));
 }
 
+// Flips found by walking every direction square by square.
+bitmap8x8 walked_flips(const game &g, bitpos p, piece_color player)
+{
+    bitmap8x8 flips = 0;
+    for (auto d : directions::all) {
+        bitmap8x8 line = 0;
+        bitpos np = next_bitpos(p, d);
+        for (; np && g[np] == opposite(player); np = next_bitpos(np, d))
+            line |= np;
+        if (np && g[np] == player)
+            flips |= line;
+    }
+    return flips;
+}
+
+void test_ray_flips()
+{
+    // tables and flips are worked out by the compiler
+    constexpr bitmap8x8 blacks = util::bit({4, 3}) | util::bit({3, 4});
+    constexpr bitmap8x8 whites = util::bit({3, 3}) | util::bit({4, 4});
+    static_assert(flipped(util::index_from_pos({3, 2}), blacks, whites) == util::bit({3, 3}));
+    static_assert(flipped(util::index_from_pos({2, 2}), blacks, whites) == 0);
+    static_assert(rays::table[0][2] == (mask::north ^ util::bit(0)));
+
+    for (int i = 0; i < 10; i++) {
+        game g;
+        while (!g.is_game_over()) {
+            for (bitpos p : positions::all())
+                for (piece_color c : {white, black})
+                    assert(flipped(util::to_index(p), c == white ? g.bitmap<white>() : g.bitmap<black>(),
+                        c == white ? g.bitmap<black>() : g.bitmap<white>()) == walked_flips(g, p, c));
+            g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+        }
+    }
+}
+
 void test_initial_condition_and_first_placement()
 {
     game g;
@@ -142,8 +184,912 @@ void test_replays()
         test_replay(r);
 }
 
+void test_possible_place_positions()
+{
+    // bitmap move generation agrees with the square by square check
+    for (int i = 0; i < 100; i++) {
+        game g;
+        while (!g.is_game_over()) {
+            positions expected = {0};
+            for (bitpos p : positions::all())
+                if (g[p] == none && g.can_play(p, g.player()))
+                    expected.set_bit(p);
+            auto possible_positions = g.possible_place_positions();
+            assert(possible_positions.bitmap == expected.bitmap);
+            g.place_piece(strat::random_strategy(g, g.player(), possible_positions));
+        }
+    }
+
+    game g;
+    bitmap8x8 whites = mask::bit(3, 3) | mask::bit(4, 4);
+    bitmap8x8 blacks = mask::bit(4, 3) | mask::bit(3, 4);
+    assert(g.moves<black>() == g.possible_place_positions().bitmap);
+    assert(popcount(g.moves<white>()) == 4);
+    assert(g.potential_moves<black>() == (neighbours(whites) & ~(whites | blacks)));
+    assert(popcount(g.potential_moves<black>()) == 10);
+    assert(g.frontier<white>() == whites);
+}
+
+void test_stable_discs()
+{
+    game g;
+    assert(g.stable<white>() == 0);
+    assert(g.stable<black>() == 0);
+
+    // a finished game fills the board, every disc is stable
+    for (bitpos p : replays[0].positions())
+        g.place_piece(p);
+    assert((g.stable<white>() | g.stable<black>()) == mask::all);
+
+    // a lone disc on any corner is stable, and so is an edge chain from it
+    for (bitmap8x8 corner : {mask::bit(0, 0), mask::bit(7, 0), mask::bit(0, 7), mask::bit(7, 7)})
+        assert(board8x8(0, corner).stable<black>() == corner);
+    bitmap8x8 chain = mask::bit(0, 0) | mask::bit(1, 0) | mask::bit(2, 0);
+    assert(board8x8(0, chain).stable<black>() == chain);
+    assert(board8x8(mask::bit(1, 0) | mask::bit(2, 0), 0).stable<white>() == 0);
+
+    // stable discs never flip until the end of the game
+    for (int i = 0; i < 100; i++) {
+        g.init();
+        bitmap8x8 stable_whites = 0, stable_blacks = 0;
+        while (!g.is_game_over()) {
+            auto possible_positions = g.possible_place_positions();
+            g.place_piece(strat::random_strategy(g, g.player(), possible_positions));
+            for (bitpos p : positions{stable_whites})
+                assert(g[p] == white);
+            for (bitpos p : positions{stable_blacks})
+                assert(g[p] == black);
+            assert((g.stable<white>() & stable_whites) == stable_whites);
+            assert((g.stable<black>() & stable_blacks) == stable_blacks);
+            stable_whites = g.stable<white>();
+            stable_blacks = g.stable<black>();
+        }
+    }
+}
+
+void test_alphabeta()
+{
+    // pruning never changes the minmax score
+    for (int i = 0; i < 20; i++) {
+        game g;
+        while (!g.is_game_over()) {
+            for (int depth = 0; depth <= 3; depth++) {
+                int expected = score::minmax_score_game_state(g, depth, score::mobility_frontier);
+                assert(search::alphabeta(g, depth, INT_MIN, INT_MAX, score::mobility_frontier) == expected);
+                if (expected != INT_MAX) // no null window above a won game
+                    assert(search::alphabeta(g, depth, expected, expected + 1, score::mobility_frontier) <= expected);
+            }
+            g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+        }
+    }
+
+    // a single move is kept whatever the search
+    game g;
+    positions first = {g.possible_place_positions().bitmap & -g.possible_place_positions().bitmap};
+    assert(strat::probcut6(g, black, first) == first.bitmap);
+}
+
+void test_linear_evaluators()
+{
+    // the feature sums score as the hand written evaluators did
+    for (int i = 0; i < 10; i++) {
+        game g;
+        while (!g.is_game_over()) {
+            auto weighted = [&](int inner, int border, int corners) {
+                return (g.count<white>(mask::inner) - g.count<black>(mask::inner)) * inner
+                    + (g.count<white>(mask::border) - g.count<black>(mask::border)) * border
+                    + (g.count<white>(mask::corners) - g.count<black>(mask::corners)) * corners;
+            };
+            int moves = popcount(g.possible_place_positions().bitmap);
+            int stable = popcount(g.stable<white>()) - popcount(g.stable<black>());
+            assert(score::pieces_diff_score(g) == g.count<white>() - g.count<black>());
+            assert(score::pieces_diff_with_borders_and_corners(g) == weighted(1, 2, 6));
+            assert(score::possible_place_positions(g) == (g.player() == white ? moves : -moves) + weighted(0, 0, 6));
+            assert(score::stable_pieces_diff(g) == weighted(1, 2, 6) + stable * 4);
+            assert(score::mobility_frontier(g)
+                == (popcount(g.moves<white>()) - popcount(g.moves<black>())) * 4
+                + popcount(g.potential_moves<white>()) - popcount(g.potential_moves<black>())
+                - popcount(g.frontier<white>()) + popcount(g.frontier<black>())
+                + weighted(0, 0, 32));
+            g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+        }
+    }
+
+    // intermediates no term needs are left out
+    static_assert(score::pieces_diff_terms::need == score::needs::discs);
+    static_assert(score::possible_place_positions_terms::need == score::needs::player_moves);
+    static_assert(score::stable_pieces_diff_terms::need == score::needs::stable);
+    static_assert(score::mobility_frontier_terms::need == score::needs::moves);
+}
+
+void test_batch_scores()
+{
+    score::function evaluators[] = {score::mobility_frontier, score::pieces_diff_score,
+        score::pieces_diff_with_borders_and_corners, score::stable_pieces_diff, score::possible_place_positions};
+    auto unbatched = [](const game &g) { return score::mobility_frontier(g); };
+    assert(!score::batched(unbatched));
+    for (auto &f : evaluators) {
+        auto evaluate = score::batched(f);
+        assert(evaluate);
+        for (int i = 0; i < 5; i++) {
+            game g;
+            while (!g.is_game_over()) {
+                // a batch scores like the evaluator does position by position
+                score::batch b;
+                for (bitpos p : g.possible_place_positions())
+                    b.push(g.test_piece(p));
+                b.generate_moves();
+                int scores[score::batch::capacity];
+                evaluate(b, scores);
+                int j = 0;
+                for (bitpos p : g.possible_place_positions())
+                    assert(scores[j++] == f(g.test_piece(p)));
+                g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+            }
+        }
+    }
+
+    // and so does a search with batched leaves, node for node
+    game g;
+    for (int i = 0; i < 20 && !g.is_game_over(); i++) {
+        for (int depth = 1; depth <= 3; depth++) {
+            search::statistics batched_stats, unbatched_stats;
+            int batched_score, unbatched_score;
+            {
+                search::collect collected;
+                batched_score = search::alphabeta(g, depth, INT_MIN, INT_MAX, score::mobility_frontier);
+                batched_stats = collected.get();
+            }
+            {
+                search::collect collected;
+                unbatched_score = search::alphabeta(g, depth, INT_MIN, INT_MAX, unbatched);
+                unbatched_stats = collected.get();
+            }
+            assert(batched_score == unbatched_score);
+            assert(batched_stats.nodes == unbatched_stats.nodes && batched_stats.leaves == unbatched_stats.leaves);
+        }
+        g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+    }
+}
+
+// Final disc difference of perfect play, by plain minimax.
+int minimax_solve(const game &g)
+{
+    if (g.is_game_over())
+        return g.count<white>() - g.count<black>();
+    bool maximize = g.player() == white;
+    int best = maximize ? -65 : 65;
+    for (bitpos p : g.possible_place_positions()) {
+        int v = minimax_solve(g.test_piece(p));
+        best = maximize ? max(best, v) : min(best, v);
+    }
+    return best;
+}
+
+// Random game stopped with empties squares left, or over before.
+game endgame_position(int empties)
+{
+    game g;
+    while (!g.is_game_over() && g.count<none>() > empties)
+        g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+    return g;
+}
+
+void test_endgame_solver()
+{
+    // the solver agrees with minimax on small endgames
+    othello::random::seed(5);
+    for (int i = 0; i < 10; i++) {
+        game g = endgame_position(8);
+        auto r = search::endgame_solver({.table_empties = 4, .order_empties = 4}).solve(g);
+        assert(r.score == minimax_solve(g));
+        if (!g.is_game_over())
+            assert(r.score == minimax_solve(g.test_piece(r.best)));
+    }
+
+    // and scores the same on any number of threads, with a shared table
+    for (int i = 0; i < 4; i++) {
+        game g = endgame_position(14);
+        int serial = search::solve(g);
+        auto table = make_shared<search::transposition_table>(16);
+        for (unsigned threads : {2u, 4u}) {
+            search::endgame_solver parallel({.threads = threads, .split_empties = 6, .table = table});
+            assert(parallel.solve(g).score == serial);
+            table->clear();
+        }
+    }
+}
+
+void test_table_memory()
+{
+    // every page mode stores the same, whatever the system provides
+    for (page_mode m : {small_pages, transparent_huge_pages, huge_pages}) {
+        search::transposition_table table(18, {m, true});
+        const large_memory &memory = table.allocation();
+        assert(memory.size() >= table.size() * 16 && memory.pages() <= m);
+        assert(!memory.describe().empty());
+        search::transposition_table::entry e = {-12, 5, search::lower, util::bit(42)}, found;
+        for (uint64 key = 1; key < 1000; key++) {
+            table.prefetch(key * 0x9e3779b97f4a7c15ULL);
+            table.store(key * 0x9e3779b97f4a7c15ULL, e);
+        }
+        assert(table.probe(999 * 0x9e3779b97f4a7c15ULL, found) && found.score == -12 && found.move == util::bit(42));
+        assert(!table.probe(1000 * 0x9e3779b97f4a7c15ULL, found));
+    }
+
+    // tables below a huge page stay on small ones
+    search::transposition_table small(10, {huge_pages});
+    assert(small.allocation().pages() == small_pages && small.allocation().huge_bytes() == 0);
+}
+
+void test_searcher()
+{
+    search::searcher searcher({.depth = 4});
+    for (int i = 0; i < 5; i++) {
+        game g;
+        while (!g.is_game_over()) {
+            // aspiration windows and move ordering do not change the score
+            auto r = searcher.search(g);
+            assert(r.score == search::alphabeta(g, 4, INT_MIN, INT_MAX, score::mobility_frontier));
+
+            // the principal variation is a legal line
+            assert(!r.pv.empty() && r.pv.size() <= 4);
+            game line = g;
+            for (bitpos p : r.pv)
+                assert(line.place_piece(p));
+
+            g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+        }
+    }
+}
+
+void test_statistics()
+{
+    auto searcher = make_shared<search::searcher>(search::settings{
+        .depth = 4,
+        .transpositions = make_shared<search::transposition_table>(16),
+    });
+    auto check = [](const search::statistics &s) {
+        unsigned long long per_ply = 0;
+        for (auto n : s.nodes_per_ply)
+            per_ply += n;
+        assert(per_ply == s.nodes && s.leaves <= s.nodes);
+        assert(s.first_move_cutoffs <= s.cutoffs && s.table_hits <= s.table_probes);
+        assert(s.endgame <= s.leaves);
+    };
+
+    game g;
+    search::result r = searcher->search(g);
+    check(r.stats);
+    assert(r.stats.nodes > 0 && r.stats.nodes_per_ply[0] >= 4 && r.stats.max_ply() == 4);
+    assert(r.stats.table_probes > 0 && r.stats.branching_factor() > 1);
+    for (int depth = 1; depth <= 4; depth++)
+        assert(r.stats.iterations[depth] == 1);
+
+    // one entry per move, empty for the strategies which do not search
+    vector<search::statistics> stats;
+    play(g, strat::search_strategy(searcher), strat::random_strategy, nullptr, nullptr, &stats);
+    assert(int(stats.size()) == g.count<any>() - 4);
+    unsigned searched = 0;
+    for (auto &s : stats) {
+        check(s);
+        searched += s.nodes > 0;
+    }
+    assert(stats[0].nodes > 0 && stats[0].iterations[4] == 1 && stats[1].nodes == 0);
+    assert(searched > 0 && searched < stats.size());
+
+    // enclosing collections see the nested searches
+    search::collect outer;
+    {
+        search::collect inner;
+        search::alphabeta(game(), 3, INT_MIN, INT_MAX, score::mobility_frontier);
+        assert(inner.get().nodes > 0 && inner.get().cutoffs > 0);
+    }
+    assert(outer.get().nodes > 0);
+}
+
+void test_ponder()
+{
+    search::settings settings = {.depth = 3};
+    search::ponderer ponder(settings);
+    search::searcher searcher(settings);
+
+    game g;
+    ponder.start(g);
+    ponder.wait();
+
+    // every reply was searched like the engine would have
+    for (bitpos p : g.possible_place_positions()) {
+        search::result r;
+        game next = g.test_piece(p);
+        assert(ponder.find(next, r));
+        assert(r.score == searcher.search(next).score);
+    }
+
+    // pondering elsewhere drops the previous results, and stops cleanly
+    search::result r;
+    game next = g.test_piece(*g.possible_place_positions().begin());
+    ponder.start(next);
+    ponder.stop();
+    assert(!ponder.find(next, r));
+}
+
+// Resumes on the executor once stop is requested.
+struct until_stopped {
+    async::executor &ex;
+    stop_token stop;
+    optional<stop_callback<function<void()>>> on_stop;
+
+    bool await_ready() const noexcept { return stop.stop_requested(); }
+    void await_suspend(coroutine_handle<> h)
+    {
+        on_stop.emplace(stop, [&e = ex, h] { e.post([h] { h.resume(); }); });
+    }
+    void await_resume() const noexcept {}
+};
+
+// Never answers, only giving up once asked to stop.
+async::task<bitpos> never_answer(async::executor &ex, async::move_context context, atomic<int> &asked)
+{
+    asked++;
+    asked.notify_all();
+    // named: GCC 12 destroys a braced temporary awaiter twice
+    until_stopped stopped{ex, context.stop};
+    co_await stopped;
+    co_return 0;
+}
+
+void test_async_play()
+{
+    async::executor ex(1);
+
+    // adapted strategies play the games play() does, several at once
+    vector<future<async::game_result>> games;
+    for (int i = 0; i < 4; i++)
+        games.push_back(async::spawn(ex, async::play(ex, game(), strat::minmax2, strat::alphabeta4)));
+    game expected;
+    play(expected, strat::minmax2, strat::alphabeta4);
+    for (auto &f : games) {
+        auto r = f.get();
+        assert(r.final == expected && r.winner == expected.winner() && r.forfeited == none && !r.cancelled);
+    }
+
+    // games waiting for moves do not hold a thread: the single one asks
+    // every game for its move, and a stop ends them all
+    atomic<int> asked{0};
+    async::strategy never = [&](game, piece_color, positions, async::move_context context) {
+        return never_answer(ex, context, asked);
+    };
+    stop_source stop_all;
+    games.clear();
+    for (int i = 0; i < 40; i++)
+        games.push_back(async::spawn(ex, async::play(ex, game(), never, never, {}, stop_all.get_token())));
+    for (int n; (n = asked.load()) < 40;)
+        asked.wait(n);
+    stop_all.request_stop();
+    for (auto &f : games) {
+        auto r = f.get();
+        assert(r.cancelled && r.final == game());
+    }
+
+    // a player missing its deadline loses, without waiting for its answer
+    auto late = async::spawn(ex, async::play(ex, game(), never, strat::random_strategy,
+        {.per_move = chrono::milliseconds(20)})).get();
+    assert(late.forfeited == black && late.winner == white && late.final == game());
+
+    // the searcher answers by the deadline, the grace being wide enough
+    // for a loaded machine
+    auto searcher = make_shared<search::searcher>(search::settings{.depth = 60});
+    auto timed = async::spawn(ex, async::play(ex, game(), async::search_strategy(searcher), strat::random_strategy,
+        {.per_move = chrono::milliseconds(10), .grace = chrono::seconds(2)})).get();
+    assert(timed.forfeited == none && timed.final.is_game_over());
+
+    // and stops once the game is cancelled, searching without a deadline
+    stop_source stop;
+    auto cancelled = async::spawn(ex, async::play(ex, game(), async::search_strategy(searcher), strat::random_strategy,
+        {}, stop.get_token()));
+    this_thread::sleep_for(chrono::milliseconds(50));
+    stop.request_stop();
+    auto r = cancelled.get();
+    assert(r.cancelled && r.winner == none && r.final == game());
+}
+
+void test_game_server()
+{
+    vector<string> replies;
+    mutex replies_mutex;
+    game_server::options options = {.threads = 1, .table_size_log2 = 16, .partitions = 4, .search = {.depth = 2}};
+    {
+        game_server server(options, [&](const string &line) {
+            lock_guard<mutex> lock(replies_mutex);
+            replies.push_back(line);
+        });
+        server.execute("a new");
+        server.execute("b new color black time 5000");
+        server.execute("a move d3");
+        server.execute("x move d3");
+        server.execute("c new strategy alphabeta depth 2");
+        server.execute("c move d3");
+        server.execute("d new strategy best");
+        server.run(*make_unique<istringstream>(""));
+        server.execute("a move a1");
+        server.execute("a move d3"); // occupied
+        server.execute("b close");
+        server.execute("stats");
+        assert(!server.execute("quit"));
+    }
+    assert(replies.size() == 11);
+    auto has = [&](const string &prefix) {
+        return any_of(replies.begin(), replies.end(), [&](const string &r) { return r.rfind(prefix, 0) == 0; });
+    };
+    assert(replies[0] == "a ok");
+    assert(has("x error unknown session"));
+    assert(has("a bestmove ") && has("b bestmove "));
+    assert(has("a error illegal move a1") && has("a error illegal move d3") && has("b ok"));
+    assert(has("c ok") && has("c bestmove ") && has("d error invalid option strategy best"));
+    assert(replies.back().rfind("stats sessions 2 moves 3 missed 0 ", 0) == 0);
+
+    // random clients play their games to the end
+    auto st = serve_load(options, {.sessions = 6, .games = 2, .depth = 2, .move_ms = 5000});
+    assert(st.sessions == 6 && st.moves >= 6 * 2 * 20 && st.missed == 0);
+    assert(st.latency.max > 0 && st.latency.p50 <= st.latency.p99);
+}
+
+void test_parse_game()
+{
+    game g, parsed;
+    for (bitpos p : replays[0].positions()) {
+        assert(io::parse_game(io::to_string(g), parsed));
+        assert(parsed == g);
+        g.place_piece(p);
+    }
+
+    assert(!io::parse_game("", parsed));
+    assert(!io::parse_game("x:" + string(64, '.'), parsed));
+    assert(!io::parse_game("b:" + string(63, '.'), parsed));
+    assert(!io::parse_game("b:" + string(63, '.') + "x", parsed));
+}
+
+void test_engine()
+{
+    stringstream out;
+    {
+        engine e(out, {.depth = 4});
+        assert(e.execute("go depth 2"));
+        assert(e.execute("isready"));
+        assert(e.execute("move f5 d6"));
+        assert(e.execute("move a1"));
+        assert(e.execute("move c3 f5")); // onto an occupied square, nothing played
+        assert(e.execute("show"));
+        assert(e.execute("position " + io::to_string(game())));
+        assert(e.execute("go time 100"));
+        assert(e.execute("stop"));
+        assert(e.execute("show"));
+        assert(e.execute("unknown"));
+        assert(!e.execute("quit"));
+    }
+
+    string line;
+    getline(out, line);
+    assert(line.rfind("bestmove ", 0) == 0 && line.find(" depth 2 ") != string::npos);
+    getline(out, line);
+    assert(line == "readyok");
+    getline(out, line);
+    assert(line == "ok");
+    getline(out, line);
+    assert(line == "error illegal move a1");
+    getline(out, line);
+    assert(line == "error illegal move f5");
+    getline(out, line);
+    game after;
+    after.place_piece(util::bit({5, 4}));
+    after.place_piece(util::bit({3, 5}));
+    assert(line == io::to_string(after));
+    getline(out, line);
+    assert(line == "ok");
+    getline(out, line);
+    assert(line.rfind("bestmove ", 0) == 0);
+    getline(out, line);
+    assert(line == io::to_string(game()));
+    getline(out, line);
+    assert(line == "error unknown command unknown");
+}
+
+void test_c_interface()
+{
+    assert(othello_abi_version() == OTHELLO_ABI_VERSION);
+
+    // a few random games, one position per ply
+    vector<othello_position> positions;
+    for (int i = 0; i < 4; i++) {
+        game g;
+        while (!g.is_game_over()) {
+            positions.push_back({g.bitmap<white>(), g.bitmap<black>(), g.player() == white ? OTHELLO_WHITE : OTHELLO_BLACK});
+            g.place_piece(strat::random_strategy(g, g.player(), g.possible_place_positions()));
+        }
+    }
+    size_t n = positions.size();
+    assert(n > score::batch::capacity);
+
+    // batched calls agree with the engine, position by position
+    vector<uint64_t> moves(n);
+    vector<int32_t> scores(n);
+    assert(othello_moves(positions.data(), n, moves.data()) == OTHELLO_OK);
+    assert(othello_evaluate(positions.data(), n, OTHELLO_MOBILITY_FRONTIER, scores.data()) == OTHELLO_OK);
+    for (size_t i = 0; i < n; i++) {
+        game g = capi::to_game(positions[i]);
+        assert(moves[i] == g.possible_place_positions().bitmap);
+        assert(scores[i] == score::mobility_frontier(g));
+    }
+
+    vector<othello_position> played = positions;
+    assert(othello_play(played.data(), moves.data(), 1) == OTHELLO_INVALID); // every legal move at once
+    vector<uint64_t> best(n);
+    othello_engine *e = othello_engine_new(OTHELLO_ALPHABETA, 2, OTHELLO_MOBILITY_FRONTIER);
+    assert(e && othello_best_moves(e, positions.data(), n, best.data()) == OTHELLO_OK);
+    for (size_t i = 0; i < n; i++)
+        assert(best[i] & moves[i]);
+    assert(othello_play(played.data(), best.data(), n) == OTHELLO_OK);
+    for (size_t i = 0; i < n; i++)
+        assert(capi::to_game(played[i]) == capi::to_game(positions[i]).test_piece(best[i]));
+
+    // one engine shared by threads
+    vector<uint64_t> shared(n);
+    vector<thread> threads;
+    for (size_t t = 0; t < 2; t++)
+        threads.emplace_back([&, t] { othello_best_moves(e, positions.data() + t * n / 2, n / 2, shared.data() + t * n / 2); });
+    for (auto &t : threads)
+        t.join();
+    for (size_t i = 0; i < n / 2 * 2; i++)
+        assert(shared[i] == best[i]);
+    othello_engine_free(e);
+
+    // bad arguments
+    othello_position bad = {1, 1, OTHELLO_WHITE};
+    assert(othello_moves(&bad, 1, moves.data()) == OTHELLO_INVALID);
+    othello_position occupied; // white on a1 b1, black on c1 would flip b1 from a1
+    othello_initial_position(&occupied);
+    occupied.whites |= 0x3;
+    occupied.blacks |= 0x4;
+    occupied.player = OTHELLO_BLACK;
+    othello_position before = occupied;
+    uint64_t a1 = 0x1;
+    assert(othello_play(&occupied, &a1, 1) == OTHELLO_INVALID);
+    assert(occupied.whites == before.whites && occupied.blacks == before.blacks);
+    assert(othello_evaluate(positions.data(), 1, 99, scores.data()) == OTHELLO_INVALID);
+    assert(!othello_engine_new(OTHELLO_PROBCUT, 4, OTHELLO_PIECES_DIFF));
+    assert(!othello_engine_new(99, 4, OTHELLO_PIECES_DIFF));
+}
+
+void test_analyze()
+{
+    stringstream in, out;
+    game g;
+    vector<game> positions;
+    for (bitpos p : replays[0].positions()) {
+        positions.push_back(g);
+        in << io::to_string(g) << '\n';
+        if (positions.size() == 3)
+            in << "not a position\n";
+        g.place_piece(p);
+    }
+    in << io::to_string(g) << '\n';
+
+    thread_pool pool(2);
+    analyze(in, out, {.depth = 2}, pool, 4);
+
+    // results come in input order: each best move is legal in its position
+    string line;
+    for (unsigned i = 0; i < positions.size(); i++) {
+        if (i == 3) {
+            getline(out, line);
+            assert(line == "error invalid position");
+        }
+        getline(out, line);
+        pos p;
+        assert(line.rfind("bestmove ", 0) == 0 && line.find(" depth 2 nodes ") != string::npos);
+        assert(io::parse_pos(line.substr(9, 2), p));
+        assert(positions[i].can_play(p, positions[i].player()));
+    }
+    getline(out, line);
+    assert(line == "gameover winner none");
+    assert(!getline(out, line));
+}
+
+void test_review_game()
+{
+    thread_pool pool(2);
+    vector<move_review> reviews;
+    auto moves = replays[0].positions();
+    assert(review_game(moves, {.depth = 3}, pool, reviews));
+    assert(reviews.size() == moves.size());
+
+    game g;
+    bool dropped = false;
+    for (unsigned i = 0; i < moves.size(); i++) {
+        const move_review &r = reviews[i];
+        assert(r.player == g.player() && r.played == moves[i]);
+        assert(g.can_play(r.best, g.player()));
+        if (r.played == r.best)
+            assert(r.drop == 0 && r.played_score == r.best_score);
+        assert(r.drop >= 0);
+        dropped |= r.drop > 0;
+        g.place_piece(moves[i]);
+    }
+    assert(dropped);
+
+    // the reviews stop at the first illegal move
+    moves.insert(moves.begin() + 2, moves[0]);
+    assert(!review_game(moves, {.depth = 1}, pool, reviews));
+    assert(reviews.size() == 2);
+}
+
+void test_trace()
+{
+    auto count = [](const string &s, const string &pattern) {
+        unsigned n = 0;
+        for (size_t i = s.find(pattern); i != string::npos; i = s.find(pattern, i + 1))
+            n++;
+        return n;
+    };
+
+    trace::start();
+    {
+        thread_pool pool(2);
+        for (int i = 0; i < 2; i++) {
+            pool.submit([]() {
+                game g;
+                play(g, strat::minmax2, strat::alphabeta4);
+            });
+        }
+    }
+    trace::stop();
+    game g;
+    play(g, strat::random_strategy, strat::random_strategy); // not traced
+
+    stringstream out;
+    trace::dump(out);
+    string json = out.str();
+    assert(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+    assert(count(json, "\"name\":\"game\"") == 4 && count(json, "\"name\":\"task\"") == 4);
+    assert(count(json, "\"ph\":\"B\"") == count(json, "\"ph\":\"E\""));
+    assert(count(json, "\"name\":\"move\",\"cat\":\"play\",\"ph\":\"B\"") >= 2 * 30);
+    assert(count(json, "\"name\":\"root move\"") > 0);
+    assert(json.find("\"tid\":1") != string::npos);
+}
+
+void test_verify()
+{
+    string log = replays[0].log;
+    string text = log + "\n\n" + log + " \n"
+        + "e6 d6 c5\n"     // incomplete
+        + "e6 e6\n"        // illegal
+        + "d3 c3 d3\n"     // onto an occupied square
+        + "e6 zz d6\n"     // unparsable
+        + log;            // no final newline
+
+    thread_pool pool(2);
+    auto report = verify_games(text.data(), text.data() + text.size(), pool);
+    assert(report.games == 7);
+    assert(report.wins[0] == 3 && report.incomplete == 1);
+    assert(report.corrupt.size() == 3);
+    sort(report.corrupt.begin(), report.corrupt.end());
+    assert(text.substr(report.corrupt[0], 6) == "e6 e6\n");
+    assert(text.substr(report.corrupt[1], 9) == "d3 c3 d3\n");
+    assert(text.substr(report.corrupt[2], 9) == "e6 zz d6\n");
+
+    stringstream binary;
+    io::write_binary_header(binary);
+    for (int i = 0; i < 50; i++)
+        io::write_binary_game(binary, replays[0].positions());
+    io::write_binary_game(binary, {util::bit(0)}); // illegal
+    io::write_binary_game(binary, io::parse_game_positions("d3 c3 d3")); // onto an occupied square
+    io::write_binary_game(binary, replays[0].positions());
+    string bytes = binary.str();
+    report = verify_games(bytes.data(), bytes.data() + bytes.size(), pool);
+    assert(report.games == 53 && report.wins[0] == 51 && report.moves == 51 * 60 + 2);
+    sort(report.corrupt.begin(), report.corrupt.end());
+    assert(report.corrupt.size() == 2 && report.corrupt[0] == 8 + 50 * 60 && report.corrupt[1] == 8 + 50 * 60 + 1);
+}
+
+void test_openings()
+{
+    // symmetries of the square move the squares as expected
+    for (int x = 0; x < 8; x++) {
+        for (int y = 0; y < 8; y++) {
+            bitpos b = util::bit({x, y});
+            assert(symmetry::flip_vertical(b) == util::bit({x, 7 - y}));
+            assert(symmetry::mirror_horizontal(b) == util::bit({7 - x, y}));
+            assert(symmetry::transpose(b) == util::bit({y, x}));
+        }
+    }
+
+    // the four first moves are symmetric, then 3 and 14 distinct positions
+    assert(enumerate_openings(1).size() == 1);
+    assert(enumerate_openings(2).size() == 3);
+    assert(enumerate_openings(3).size() == 14);
+
+    thread_pool pool(2);
+    auto all = generate_openings(4, {.depth = 2}, INT_MAX - 1, pool);
+    auto balanced = generate_openings(4, {.depth = 2}, 4, pool);
+    assert(all.size() == enumerate_openings(4).size() && balanced.size() < all.size());
+    assert(!balanced.empty());
+
+    stringstream file;
+    write_openings(file, balanced);
+    assert(file.str().size() == 8 + 4 * balanced.size());
+    vector<opening> read;
+    assert(read_openings(file, read) && read == balanced);
+
+    string corrupt = file.str();
+    corrupt[9] = corrupt[8]; // the same move twice
+    stringstream corrupt_file(corrupt);
+    assert(!read_openings(corrupt_file, read));
+
+    // deterministic strategies play a different game from each opening
+    vector<double> results;
+    for (unsigned i = 0; i < 6; i++) {
+        game g = start_position(&balanced, i);
+        assert(g.count<any>() == 8);
+        play(g, strat::minmax2, strat::max_mobility);
+        results.push_back(g.count<white>());
+    }
+    sort(results.begin(), results.end());
+    assert(results.front() != results.back());
+    double w = winrate(strat::minmax2, strat::minmax2, 4, &balanced);
+    assert(w >= 0 && w <= 1);
+}
+
+void test_seeded_runs()
+{
+    auto game_log = [](uint64_t stream) {
+        othello::random::stream s(stream);
+        game g;
+        vector<bitpos> moves;
+        while (!g.is_game_over()) {
+            bitpos p = strat::random_strategy(g, g.player(), g.possible_place_positions());
+            moves.push_back(p);
+            g.place_piece(p);
+        }
+        return moves;
+    };
+
+    othello::random::seed(42);
+    auto first = game_log(0), second = game_log(1);
+    assert(first != second);
+    double wins = wincount(strat::random_strategy, strat::random_strategy_with_corners_and_borders_first, 20);
+
+    // same seed, same games, whichever thread plays them and when
+    othello::random::seed(7);
+    assert(game_log(0) != first);
+    othello::random::seed(42);
+    thread_pool pool(2);
+    auto parallel_second = pool.submit([&]() { return game_log(1); });
+    auto parallel_wins = pool.submit([]() { return wincount(strat::random_strategy, strat::random_strategy_with_corners_and_borders_first, 20); });
+    assert(game_log(0) == first && parallel_second.get() == second);
+    assert(parallel_wins.get() == wins);
+}
+
+void test_sprt()
+{
+    sprt_settings settings = {.elo0 = 0, .elo1 = 100, .max_games = 200};
+    sprt_result r = sprt(strat::alphabeta4, strat::random_strategy, settings);
+    assert(r.decision == sprt_accept_elo1 && r.games() < 200);
+    assert(r.elo() > 100 && r.elo_low() <= r.elo() && r.elo() <= r.elo_high());
+
+    r = sprt(strat::random_strategy, strat::alphabeta4, settings);
+    assert(r.decision == sprt_accept_elo0 && r.games() < 200 && r.elo() < 0);
+
+    // equal scores make even elo
+    r = {.wins = 10, .draws = 4, .losses = 10};
+    assert(r.elo() == 0 && r.elo_low() < 0 && r.elo_high() > 0);
+    assert(fabs(score_from_elo(r.elo_from_score(0.75)) - 0.75) < 1e-9);
+}
+
+void test_report()
+{
+    vector<float> samples;
+    for (int i = 1; i <= 100; i++)
+        samples.push_back(i);
+    auto l = report::latency::of(samples);
+    assert(l.mean == 50.5 && l.p50 == 51 && l.p90 == 91 && l.p99 == 100 && l.max == 100);
+
+    report::run base;
+    base.metadata = report::host_metadata("v1");
+    base.games = 200;
+    base.games_per_s = 10;
+    base.strategies.push_back({"fast \"one\"", 100, 3000, 0, 0, {100, 10, 100, 110, 130, 150}, 0.5, 0.4, 0.6});
+    base.strategies.push_back({"strong", 100, 3000, 0, 0, {100, 10, 100, 110, 130, 150}, 0.8, 0.72, 0.88});
+
+    stringstream file;
+    report::write_json(file, base);
+    report::run read;
+    assert(report::read_json(file, read));
+    assert(read.metadata == base.metadata && read.games_per_s == 10);
+    assert(read.strategies.size() == 2 && read.strategies[0].name == "fast \"one\"");
+    assert(read.strategies[1].move_latency.p99 == 130 && read.strategies[1].score_low == 0.72);
+    assert(report::compare(base, read).empty());
+
+    // slower by far more than the noise, weaker outside both intervals
+    report::run current = read;
+    current.strategies[0].move_latency.mean = 120;
+    current.strategies[1].score = 0.4;
+    current.strategies[1].score_low = 0.3;
+    current.strategies[1].score_high = 0.5;
+    auto regressions = report::compare(base, current);
+    assert(regressions.size() == 2);
+    assert(regressions[0].what == "latency" && regressions[1].what == "strength");
+
+    // within the noise
+    current = read;
+    current.strategies[0].move_latency.mean = 100.5;
+    current.strategies[1].score = 0.78;
+    current.games_per_s = 9.2;
+    assert(report::compare(base, current).empty());
+
+    // lower throughput past the threshold, nodes/s compared only where
+    // both runs counted nodes
+    current = read;
+    current.games_per_s = 8.9;
+    current.strategies[0].nodes = current.strategies[1].nodes = 1e6;
+    current.strategies[0].nodes_per_s = current.strategies[1].nodes_per_s = 1e5;
+    assert(report::compare(base, current).size() == 1);
+    base.strategies[0].nodes = 1e6;
+    base.strategies[0].nodes_per_s = 2e5;
+    regressions = report::compare(base, current);
+    assert(regressions.size() == 2);
+    assert(regressions[0].what == "games/s" && regressions[1].what == "nodes/s");
+    assert(regressions[1].strategy == "fast \"one\"" && regressions[1].z == 0);
+
+    stringstream bad("{\"strategies\": [");
+    assert(!report::read_json(bad, read));
+}
+
+void test_jobs()
+{
+    auto dir = filesystem::temp_directory_path() / ("othello-jobs-" + to_string(getpid()));
+    filesystem::remove_all(dir);
+    jobs::queue q(dir);
+    assert(!q.exists());
+    q.create({{"kind", "test"}, {"depth", "4"}});
+    assert(q.exists() && q.setup()["kind"] == "test" && q.setup()["depth"] == "4");
+    for (unsigned i = 0; i < 200; i++)
+        q.add(jobs::queue::make_id(i), to_string(i));
+
+    // a worker dies with a job claimed, another one takes it over
+    string id, job;
+    assert(q.claim(id, job, "host.1"));
+    assert(q.count("pending") == 199 && q.count("claimed") == 1);
+    assert(q.requeue([](const string &worker, chrono::seconds) { return worker == "host.2"; }) == 0);
+    assert(q.requeue([](const string &worker, chrono::seconds) { return worker == "host.1"; }) == 1);
+    assert(q.count("pending") == 200 && q.count("claimed") == 0);
+
+    // concurrent workers claim every job exactly once
+    vector<thread> workers;
+    for (int w = 0; w < 4; w++) {
+        workers.emplace_back([&q, w]() {
+            string id, job;
+            while (q.claim(id, job, "host." + to_string(w)))
+                q.complete(id, job + " done", "host." + to_string(w));
+        });
+    }
+    for (auto &w : workers)
+        w.join();
+    auto results = q.results();
+    assert(results.size() == 200 && q.count("pending") == 0 && q.count("claimed") == 0);
+    unsigned i = 0;
+    for (auto &r : results) {
+        assert(r.first == jobs::queue::make_id(i) && r.second == to_string(i) + " done");
+        i++;
+    }
+    filesystem::remove_all(dir);
+}
+
 void test_benchmark_winrate()
 {
+    // random matches are short, play them on a fixed seed
+    othello::random::seed(1);
+
     vector<strategy> all = {
         strat::random_strategy,
         strat::random_strategy_with_borders_first,
@@ -164,14 +1110,43 @@ void test_benchmark_winrate()
     assert(better_than(strat::minmax2corners, strat::minmax2));
     assert(better_than(strat::minmax4, strat::minmax2));
     assert(better_than(strat::minmax4corners, strat::minmax4));
+    assert(better_than(strat::minmax2stable, strat::minmax2corners));
+    assert(better_than(strat::max_mobility, strat::max_liberty));
+    assert(better_than(strat::alphabeta4, strat::minmax4));
+    assert(better_than(strat::probcut6, strat::alphabeta4));
 }
 
 int main()
 {
     test_positions();
     test_bitpos_direction();
+    test_ray_flips();
     test_initial_condition_and_first_placement();
     test_parse_game_positions();
     test_replays();
+    test_possible_place_positions();
+    test_stable_discs();
+    test_alphabeta();
+    test_linear_evaluators();
+    test_batch_scores();
+    test_table_memory();
+    test_searcher();
+    test_endgame_solver();
+    test_statistics();
+    test_ponder();
+    test_async_play();
+    test_game_server();
+    test_parse_game();
+    test_engine();
+    test_c_interface();
+    test_analyze();
+    test_review_game();
+    test_trace();
+    test_verify();
+    test_openings();
+    test_seeded_runs();
+    test_sprt();
+    test_report();
+    test_jobs();
     test_benchmark_winrate();
 }
\ No newline at end of file
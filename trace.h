@@ -0,0 +1,154 @@
+#ifndef OTHELLO_TRACE_H
+#define OTHELLO_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace othello::trace {
+
+// Begin and end events of the traced scopes, dumped in the Chrome trace
+// event format (chrome://tracing, Perfetto). Off by default: a disabled
+// scope costs one relaxed load. When enabled, each thread writes to its
+// own ring buffer without locks, keeping its latest events only.
+struct event {
+    const char *name; // static strings only, never copied
+    const char *category;
+    char phase; // 'B' begin, 'E' end
+    int64_t arg;
+    std::chrono::steady_clock::time_point time;
+};
+
+class ring {
+    std::unique_ptr<event[]> events;
+    std::atomic<uint64_t> written{0};
+
+public:
+    static constexpr uint64_t capacity = 1 << 16;
+    const unsigned tid;
+
+    explicit ring(unsigned t)
+        : events(new event[capacity]), tid(t)
+    {}
+
+    // Only called by the owning thread.
+    void push(const event &e)
+    {
+        uint64_t n = written.load(std::memory_order_relaxed);
+        events[n % capacity] = e;
+        written.store(n + 1, std::memory_order_release);
+    }
+
+    template<typename F>
+    void for_each(F f) const
+    {
+        uint64_t n = written.load(std::memory_order_acquire);
+        for (uint64_t i = n > capacity ? n - capacity : 0; i < n; i++)
+            f(events[i % capacity]);
+    }
+
+    void clear() { written.store(0, std::memory_order_relaxed); }
+};
+
+struct registry {
+    std::atomic<bool> enabled{false};
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ring>> rings; // outlive their threads
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+registry &global()
+{
+    static registry r;
+    return r;
+}
+
+// Ring of the calling thread, registered on its first event.
+ring &local()
+{
+    thread_local std::shared_ptr<ring> r = [] {
+        registry &g = global();
+        std::lock_guard<std::mutex> lock(g.mutex);
+        g.rings.push_back(std::make_shared<ring>(g.rings.size() + 1));
+        return g.rings.back();
+    }();
+    return *r;
+}
+
+bool enabled()
+{
+    return global().enabled.load(std::memory_order_relaxed);
+}
+
+void start()
+{
+    registry &g = global();
+    {
+        std::lock_guard<std::mutex> lock(g.mutex);
+        for (auto &r : g.rings)
+            r->clear();
+    }
+    g.enabled = true;
+}
+
+void stop()
+{
+    global().enabled = false;
+}
+
+// Traces its lifetime, arg is shown with the event, a move or a depth.
+class scope {
+    const char *name;
+    const char *category;
+    bool recording;
+
+public:
+    scope(const char *n, const char *c, int64_t arg = 0)
+        : name(n), category(c), recording(enabled())
+    {
+        if (recording)
+            local().push({name, category, 'B', arg, std::chrono::steady_clock::now()});
+    }
+
+    ~scope()
+    {
+        if (recording)
+            local().push({name, category, 'E', 0, std::chrono::steady_clock::now()});
+    }
+
+    scope(const scope &) = delete;
+    scope &operator=(const scope &) = delete;
+};
+
+// Writes the events of every thread as a Chrome trace JSON document. The
+// traced threads should be done, or their latest events may be missing.
+void dump(std::ostream &out)
+{
+    registry &g = global();
+    std::lock_guard<std::mutex> lock(g.mutex);
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto &r : g.rings) {
+        r->for_each([&](const event &e) {
+            auto us = std::chrono::duration<double, std::micro>(e.time - g.epoch).count();
+            out << (first ? "\n" : ",\n")
+                << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+                << "\",\"ph\":\"" << e.phase << "\",\"ts\":" << std::fixed << us
+                << ",\"pid\":1,\"tid\":" << r->tid;
+            if (e.phase == 'B')
+                out << ",\"args\":{\"value\":" << e.arg << "}";
+            out << "}";
+            first = false;
+        });
+    }
+    out << "\n]}\n";
+    out.unsetf(std::ios::floatfield);
+}
+
+}
+
+#endif // OTHELLO_TRACE_H
@@ -6,6 +6,9 @@
 #endif
 
 #define first_bit_index(x) __builtin_ctzll(x)
+#define last_bit_index(x) (63 - __builtin_clzll(x))
+
+#include <array>
 
 namespace othello {
 
@@ -141,7 +144,7 @@ namespace mask {
     constexpr bitmap8x8 inner = all ^ border;
     constexpr bitmap8x8 north =
         bit(0, 0) | bit(1, 0) | bit(2, 0) | bit(3, 0) |
-        bit(4, 0) | bit(5, 0) | bit(6, 0) | bit(6, 0);
+        bit(4, 0) | bit(5, 0) | bit(6, 0) | bit(7, 0);
     constexpr bitmap8x8 south =
         bit(0, util::last) | bit(1, util::last) | bit(2, util::last) | bit(3, util::last) |
         bit(4, util::last) | bit(5, util::last) | bit(6, util::last) | bit(7, util::last);
@@ -155,6 +158,22 @@ namespace mask {
     constexpr bitmap8x8 ne = north | east;
     constexpr bitmap8x8 sw = south | west;
     constexpr bitmap8x8 se = south | east;
+
+    // diagonal d holds the squares where x - y == d - 7 (NW to SE lines),
+    // anti diagonal d the squares where x + y == d (NE to SW lines)
+    static constexpr std::array<bitmap8x8, 15> make_diagonals(bool anti) {
+        std::array<bitmap8x8, 15> lines = {};
+        for (int y = 0; y < util::size; y++) {
+            for (int x = 0; x < util::size; x++) {
+                int d = anti ? x + y : x - y + util::last;
+                lines[d] |= bit(x, y);
+            }
+        }
+        return lines;
+    }
+
+    constexpr std::array<bitmap8x8, 15> diagonals = make_diagonals(false);
+    constexpr std::array<bitmap8x8, 15> anti_diagonals = make_diagonals(true);
 }
 
 namespace directions {
@@ -190,6 +209,81 @@ constexpr bitpos next_bitpos(bitpos b, direction d) {
     }
 }
 
+// Squares met from a square going in a direction, up to the board edge:
+// rays::table[i][k] from square index i in direction rays::order[k].
+// Built at compile time, nothing to initialize when the program starts.
+namespace rays {
+    constexpr direction order[8] = {N, S, E, W, NW, NE, SW, SE};
+
+    static constexpr std::array<std::array<bitmap8x8, 8>, 64> make() {
+        std::array<std::array<bitmap8x8, 8>, 64> r = {};
+        for (int i = 0; i < 64; i++)
+            for (int k = 0; k < 8; k++)
+                for (bitpos p = next_bitpos(util::bit(index(i)), order[k]); p; p = next_bitpos(p, order[k]))
+                    r[i][k] |= p;
+        return r;
+    }
+
+    constexpr std::array<std::array<bitmap8x8, 8>, 64> table = make();
+}
+
+// Opponent discs flipped by a player disc on square index i: on each
+// ray, the opponent discs before the first other square, when that
+// square holds a player disc. A few lookups and bit operations per ray.
+constexpr bitmap8x8 flipped(index i, bitmap8x8 player, bitmap8x8 opponent) {
+    bitmap8x8 flips = 0;
+    for (int k = 0; k < 8; k++) {
+        bitmap8x8 ray = rays::table[i][k];
+        bitmap8x8 stop = ray & ~opponent;
+        if (!stop)
+            continue;
+        // rays going up the indexes meet their lowest square first
+        bool up = rays::order[k] > 0;
+        bitmap8x8 first = up ? stop & -stop : bitmap8x8(1) << last_bit_index(stop);
+        if (first & player)
+            flips |= ray & (up ? first - 1 : ~(first | (first - 1)));
+    }
+    return flips;
+}
+
+// Shifts a whole bitmap one square in direction d; squares leaving the
+// board are dropped, as in next_bitpos.
+template<direction d>
+constexpr bitmap8x8 shift(bitmap8x8 b) {
+    switch (d)
+    {
+    case N: return b >> 8;
+    case S: return b << 8;
+    case W: return (b & ~mask::west) >> 1;
+    case E: return (b & ~mask::east) << 1;
+    case NW: return (b & ~mask::west) >> 9;
+    case NE: return (b & ~mask::east) >> 7;
+    case SW: return (b & ~mask::west) << 7;
+    case SE: return (b & ~mask::east) << 9;
+    default:
+        return 0;
+    }
+}
+
+// Squares adjacent to any square of b.
+constexpr bitmap8x8 neighbours(bitmap8x8 b) {
+    bitmap8x8 h = b | shift<E>(b) | shift<W>(b);
+    return (h | shift<N>(h) | shift<S>(h)) & ~b;
+}
+
+// Empty squares from which a line of opponent discs in direction d ends
+// on one of the player's discs.
+template<direction d>
+constexpr bitmap8x8 moves_in_direction(bitmap8x8 player, bitmap8x8 opponent, bitmap8x8 empty) {
+    bitmap8x8 x = shift<d>(player) & opponent;
+    x |= shift<d>(x) & opponent;
+    x |= shift<d>(x) & opponent;
+    x |= shift<d>(x) & opponent;
+    x |= shift<d>(x) & opponent;
+    x |= shift<d>(x) & opponent;
+    return shift<d>(x) & empty;
+}
+
 class board8x8 {
 private:
     bitmap8x8 whites;
@@ -204,11 +298,32 @@ public:
         : whites(b.whites), blacks(b.blacks)
     {}
 
+    constexpr board8x8(bitmap8x8 whites_, bitmap8x8 blacks_)
+        : whites(whites_), blacks(blacks_)
+    {}
+
     void reset()
     {
         whites = blacks = 0;
     }
 
+    constexpr bool operator==(const board8x8 &o) const
+    {
+        return whites == o.whites && blacks == o.blacks;
+    }
+
+    // Well distributed 64 bits key of the position (murmur3 finalizer).
+    constexpr uint64 hash() const
+    {
+        uint64 h = whites * 0x9e3779b97f4a7c15ULL ^ (blacks + 0x632be59bd9b4e019ULL) * 0xc2b2ae3d27d4eb4fULL;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
     template<piece_color pc>
     constexpr bool has(bitpos b) const
     {
@@ -280,6 +395,124 @@ public:
         default: return popcount((whites | blacks) & mask);
         }
     }
+
+    template<piece_color color>
+    constexpr bitmap8x8 bitmap() const {
+        switch (color) {
+        case white: return whites;
+        case black: return blacks;
+        case none: return nones();
+        default: return whites | blacks;
+        }
+    }
+
+    // All legal moves of color, generated for every square at once.
+    template<piece_color color>
+    constexpr bitmap8x8 moves() const
+    {
+        bitmap8x8 player = bitmap<color>();
+        bitmap8x8 opponent = bitmap<opposite(color)>();
+        bitmap8x8 empty = nones();
+        return moves_in_direction<N>(player, opponent, empty)
+            | moves_in_direction<S>(player, opponent, empty)
+            | moves_in_direction<E>(player, opponent, empty)
+            | moves_in_direction<W>(player, opponent, empty)
+            | moves_in_direction<NW>(player, opponent, empty)
+            | moves_in_direction<NE>(player, opponent, empty)
+            | moves_in_direction<SW>(player, opponent, empty)
+            | moves_in_direction<SE>(player, opponent, empty);
+    }
+
+    constexpr bitmap8x8 moves(piece_color color) const
+    {
+        return color == white ? moves<white>() : moves<black>();
+    }
+
+    // Discs flipped by a disc of color on p, occupied or not.
+    template<piece_color color>
+    constexpr bitmap8x8 flips(bitpos p) const
+    {
+        return flipped(util::to_index(p), bitmap<color>(), bitmap<opposite(color)>());
+    }
+
+    constexpr bitmap8x8 flips(bitpos p, piece_color color) const
+    {
+        return color == white ? flips<white>(p) : flips<black>(p);
+    }
+
+    // Empty squares next to the opponent: moves that may become legal.
+    template<piece_color color>
+    constexpr bitmap8x8 potential_moves() const
+    {
+        return neighbours(bitmap<opposite(color)>()) & nones();
+    }
+
+    // Discs of color touching an empty square.
+    template<piece_color color>
+    constexpr bitmap8x8 frontier() const
+    {
+        return neighbours(nones()) & bitmap<color>();
+    }
+
+    // Squares lying on a completely filled horizontal, vertical,
+    // diagonal and anti diagonal line respectively.
+    constexpr void full_lines(bitmap8x8 &h, bitmap8x8 &v, bitmap8x8 &d, bitmap8x8 &a) const
+    {
+        bitmap8x8 filled = whites | blacks;
+
+        // fold every row into its first column
+        h = filled & (filled >> 4);
+        h &= h >> 2;
+        h &= h >> 1;
+        h = (h & mask::west) * 0xff;
+
+        // fold every column into the first row
+        v = filled & (filled >> 32);
+        v &= v >> 16;
+        v &= v >> 8;
+        v = (v & mask::north) * 0x0101010101010101ULL;
+
+        d = a = 0;
+        for (bitmap8x8 line : mask::diagonals)
+            if ((filled & line) == line)
+                d |= line;
+        for (bitmap8x8 line : mask::anti_diagonals)
+            if ((filled & line) == line)
+                a |= line;
+    }
+
+    // Discs that cannot be flipped for the rest of the game: a disc is
+    // stable when, along each of the four lines crossing it, the line is
+    // full or one of its neighbours is the board edge or another stable
+    // disc of the same color. Starting from the corners, stability is
+    // propagated until it reaches a fixed point.
+    template<piece_color color>
+    constexpr bitmap8x8 stable() const
+    {
+        bitmap8x8 own = bitmap<color>();
+        bitmap8x8 full_h, full_v, full_d, full_a;
+        full_lines(full_h, full_v, full_d, full_a);
+        full_h |= mask::west | mask::east;
+        full_v |= mask::north | mask::south;
+        // not mask::border, which leaves out a1
+        bitmap8x8 edges = mask::north | mask::south | mask::west | mask::east;
+        full_d |= edges;
+        full_a |= edges;
+
+        // shifted bits wrapping around the board land on the border,
+        // which is already safe for the corresponding line
+        bitmap8x8 s = 0;
+        for (;;) {
+            bitmap8x8 next = own
+                & (full_h | (s >> 1) | (s << 1))
+                & (full_v | (s >> 8) | (s << 8))
+                & (full_d | (s >> 9) | (s << 9))
+                & (full_a | (s >> 7) | (s << 7));
+            if (next == s)
+                return s;
+            s = next;
+        }
+    }
 };
 
 }
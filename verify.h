@@ -0,0 +1,192 @@
+#ifndef OTHELLO_VERIFY_H
+#define OTHELLO_VERIFY_H
+
+#include <algorithm>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core.h"
+#include "io.h"
+#include "pool.h"
+
+namespace othello {
+
+// Read only view of a whole file mapped in memory.
+class mapped_file {
+    const char *bytes = nullptr;
+    size_t length = 0;
+
+public:
+    explicit mapped_file(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                bytes = static_cast<const char *>(p);
+                length = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    ~mapped_file()
+    {
+        if (bytes)
+            munmap(const_cast<char *>(bytes), length);
+    }
+
+    const char *begin() const { return bytes; }
+    const char *end() const { return bytes + length; }
+    size_t size() const { return length; }
+};
+
+struct verify_report {
+    uint64 games = 0;
+    uint64 moves = 0;
+    uint64 incomplete = 0; // legal moves, but the game is not over
+    uint64 wins[3] = {0, 0, 0}; // none, white, black
+    std::vector<uint64> corrupt; // file offsets of the invalid records
+
+    void merge(const verify_report &o)
+    {
+        games += o.games;
+        moves += o.moves;
+        incomplete += o.incomplete;
+        for (int i = 0; i < 3; i++)
+            wins[i] += o.wins[i];
+        corrupt.insert(corrupt.end(), o.corrupt.begin(), o.corrupt.end());
+    }
+
+    void finish(const game &g, uint64 offset, bool valid)
+    {
+        games++;
+        if (!valid)
+            corrupt.push_back(offset);
+        else if (!g.is_game_over())
+            incomplete++;
+        else
+            wins[g.winner() == none ? 0 : g.winner() == white ? 1 : 2]++;
+    }
+};
+
+// Text records, one game per line as written by the --output option of
+// the othello binary: moves separated by blanks.
+verify_report verify_text_games(const char *begin, const char *end, uint64 offset)
+{
+    auto blank = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    verify_report report;
+    const char *p = begin;
+    while (p < end) {
+        const char *record = p;
+        game g;
+        bool valid = true;
+        bool empty = true;
+        for (; p < end && *p != '\n'; p++) {
+            if (blank(*p) || !valid)
+                continue;
+
+            pos square;
+            empty = false;
+            bool separated = end - p == 2 || (end - p > 2 && blank(p[2]));
+            if (end - p < 2 || !separated || !io::parse_square(p[0], p[1], square)
+                || !g.place_piece(square)) {
+                valid = false;
+                continue;
+            }
+            report.moves++;
+            p++;
+        }
+        p++; // newline
+
+        if (!empty)
+            report.finish(g, offset + (record - begin), valid);
+    }
+    return report;
+}
+
+// Binary records, see io::write_binary_game.
+verify_report verify_binary_games(const char *begin, const char *end, uint64 offset)
+{
+    verify_report report;
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(begin);
+    const unsigned char *last = reinterpret_cast<const unsigned char *>(end);
+    while (p < last) {
+        const unsigned char *record = p;
+        game g;
+        bool valid = true;
+        bool ended = false;
+        while (p < last && !ended) {
+            unsigned char c = *p++;
+            ended = c & io::binary_last_move;
+            if (!valid)
+                continue;
+            if ((c & 0x40) || !g.place_piece(util::bit(c & 0x3f)))
+                valid = false;
+            else
+                report.moves++;
+        }
+        report.finish(g, offset + (record - reinterpret_cast<const unsigned char *>(begin)), valid && ended);
+    }
+    return report;
+}
+
+// Replays and validates every game of a text or binary record file,
+// split in one chunk of whole records per pool thread.
+verify_report verify_games(const char *begin, const char *end, thread_pool &pool)
+{
+    const char *magic = io::binary_games_magic;
+    bool binary = size_t(end - begin) >= sizeof(io::binary_games_magic)
+        && std::equal(magic, magic + sizeof(io::binary_games_magic), begin);
+    const char *data = binary ? begin + sizeof(io::binary_games_magic) : begin;
+
+    // chunks start right after the end of a record
+    auto record_start = [&](const char *p) {
+        if (p <= data)
+            return data;
+        for (; p < end; p++) {
+            if (binary ? (p[-1] & io::binary_last_move) : p[-1] == '\n')
+                return p;
+        }
+        return end;
+    };
+
+    unsigned chunks = pool.size() * 4;
+    std::vector<std::future<verify_report>> parts;
+    const char *chunk = data;
+    for (unsigned i = 1; i <= chunks && chunk < end; i++) {
+        const char *next = (i == chunks) ? end : record_start(data + (end - data) * i / chunks);
+        if (next <= chunk)
+            continue;
+        uint64 offset = chunk - begin;
+        parts.push_back(pool.submit([=]() {
+            return binary
+                ? verify_binary_games(chunk, next, offset)
+                : verify_text_games(chunk, next, offset);
+        }));
+        chunk = next;
+    }
+
+    verify_report report;
+    for (auto &part : parts)
+        report.merge(part.get());
+    return report;
+}
+
+}
+
+#endif // OTHELLO_VERIFY_H